@@ -0,0 +1,724 @@
+/*
+ * Headless benchmarks for curses++.
+ *
+ * curses runs through newterm() with a fixed terminal type and size, writing
+ * into an anonymous temporary file whose offset counts the bytes emitted, so
+ * no terminal is needed and the numbers are comparable between machines and
+ * runs. Every
+ * benchmark reports the time per operation, the operations (or frames) per
+ * second, the bytes sent to the terminal and the heap allocations made per
+ * operation.
+ *
+ * Build and run:
+ *
+ *     g++ -std=c++11 -O2 benchmark.cpp curses++.cpp -o benchmark -lpanelw -lncursesw -pthread
+ *     ./benchmark
+ *
+ * Built with -std=c++20 it also measures coroutine tasks.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "curses++.h"
+
+using namespace cursesxx;
+
+/* every heap allocation in the program, counted by the operator new below */
+static std::size_t allocations = 0;
+
+void* operator new( std::size_t size ) {
+    ++allocations;
+    if( void* p = std::malloc( size ? size : 1 ) ) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[]( std::size_t size ) {
+    return ::operator new( size );
+}
+
+void operator delete( void* p ) noexcept {
+    std::free( p );
+}
+
+void operator delete[]( void* p ) noexcept {
+    ::operator delete( p );
+}
+
+/* the sized forms C++14 calls when the size is known */
+void operator delete( void* p, std::size_t ) noexcept {
+    ::operator delete( p );
+}
+
+void operator delete[]( void* p, std::size_t ) noexcept {
+    ::operator delete( p );
+}
+
+namespace {
+
+    const char* const terminal = "xterm-256color";
+    const int lines = 50;
+    const int cols = 200;
+
+    /* curses writes straight to the descriptor, bypassing stdio */
+    FILE* sink = nullptr;
+
+    std::size_t emitted() {
+        std::fflush( sink );
+        return lseek( fileno( sink ), 0, SEEK_CUR );
+    }
+
+    /*
+     * Runs op iterations times, after one untimed warm-up run, and prints one
+     * row of the report.
+     */
+    template< typename Op >
+        void measure( const char* name, const int iterations, Op op ) {
+            using clock = std::chrono::steady_clock;
+
+            op( 0 );
+
+            const std::size_t bytes = emitted();
+            const std::size_t allocated = allocations;
+            const auto start = clock::now();
+
+            for( int i = 1; i <= iterations; ++i ) op( i );
+
+            const auto end = clock::now();
+            const double ns = std::chrono::duration< double, std::nano >(
+                    end - start ).count() / iterations;
+            const double allocs = double( allocations - allocated ) / iterations;
+
+            std::printf( "%-34s %10d %12.1f %12.0f %10.1f %10.2f\n",
+                    name, iterations, ns, 1e9 / ns,
+                    double( emitted() - bytes ) / iterations, allocs );
+        }
+
+    void header( const char* title ) {
+        std::printf( "\n%-34s %10s %12s %12s %10s %10s\n",
+                title, "iterations", "ns/op", "op/s", "bytes/op", "allocs/op" );
+    }
+
+    /*
+     * A dashboard of labelled counters where one value changes per tick, the
+     * common case the frame and damage tracking work targets.
+     */
+    void dashboard( Application& app, const char* title ) {
+        header( title );
+
+        std::vector< std::unique_ptr< Textfield > > fields;
+        for( int i = 0; i < 60; ++i ) {
+            const Anchor at( ( i / 4 ) * 3, ( i % 4 ) * 40 );
+            fields.emplace_back( new Textfield( "counter " + std::to_string( i )
+                        + "\nvalue 0", Geometry( 2, 30 ), at ) );
+        }
+
+        measure( "redraw all, wrefresh each", 2000, [&]( int i ) {
+            fields[ i % 60 ]->write( "counter " + std::to_string( i % 60 )
+                    + "\nvalue " + std::to_string( i ) );
+            for( auto& field : fields ) field->redraw();
+        } );
+
+        measure( "redraw all, one frame", 2000, [&]( int i ) {
+            app.begin_frame();
+            fields[ i % 60 ]->write( "counter " + std::to_string( i % 60 )
+                    + "\nvalue " + std::to_string( i ) );
+            for( auto& field : fields ) field->redraw();
+            app.commit();
+        } );
+
+        /* the counter formatted into a buffer and written as a Text */
+        char buffer[ 64 ];
+
+        measure( "update one counter, one frame", 20000, [&]( int i ) {
+            const int len = std::snprintf( buffer, sizeof( buffer ),
+                    "counter %d\nvalue %d", i % 60, i );
+
+            app.begin_frame();
+            fields[ i % 60 ]->write( Text( buffer, len ) );
+            fields[ i % 60 ]->redraw();
+            app.commit();
+        } );
+
+        /* a dialog over the middle of the dashboard, covering a few fields */
+        Dialog popup( Geometry( 4, 40 ), "connection lost\nretrying" );
+
+        measure( "popup shown/hidden, one frame", 2000, [&]( int i ) {
+            app.begin_frame();
+            if( i % 2 ) popup.show();
+            else popup.hide();
+            app.commit();
+        } );
+
+        popup.show();
+
+        measure( "update one counter under popup", 20000, [&]( int i ) {
+            const int len = std::snprintf( buffer, sizeof( buffer ),
+                    "counter %d\nvalue %d", i % 60, i );
+
+            app.begin_frame();
+            fields[ i % 60 ]->write( Text( buffer, len ) );
+            fields[ i % 60 ]->redraw();
+            app.commit();
+        } );
+    }
+
+    void widgets( Application& app ) {
+        header( "widgets (one frame per op)" );
+
+        Widget widget( Geometry( 20, 80 ), Anchor( 5, 10 ) );
+        const std::string line( 60, 'x' );
+
+        measure( "Widget::write", 20000, [&]( int i ) {
+            app.begin_frame();
+            widget.write( line.c_str() + i % 30, 10, i % 20, 0 );
+            widget.redraw();
+            app.commit();
+        } );
+
+        /* the same, with two of every three characters outside ASCII */
+        std::string wide;
+        while( wide.size() < 120 ) wide += "é─x";
+
+        measure( "Widget::write (UTF-8)", 20000, [&]( int i ) {
+            app.begin_frame();
+            widget.write( wide.c_str() + ( i % 10 ) * 6, 30, i % 20, 0 );
+            widget.redraw();
+            app.commit();
+        } );
+
+        measure( "Widget::put", 20000, [&]( int i ) {
+            app.begin_frame();
+            widget.put( 'a' + i % 26, i % 20, i % 80 );
+            widget.redraw();
+            app.commit();
+        } );
+
+        Textfield field( std::string( 40, '-' ), Geometry( 20, 80 ) );
+
+        measure( "Textfield::write (one value)", 20000, [&]( int i ) {
+            app.begin_frame();
+            field.write( "requests: " + std::to_string( i ) + "\nstatic line" );
+            field.redraw();
+            app.commit();
+        } );
+
+        measure( "Textfield::write (UTF-8 value)", 20000, [&]( int i ) {
+            app.begin_frame();
+            field.write( "débit ─ " + std::to_string( i ) + "\nstatic line" );
+            field.redraw();
+            app.commit();
+        } );
+
+        measure( "Textfield::append (line)", 20000, [&]( int i ) {
+            app.begin_frame();
+            field.append( "\nlog line " + std::to_string( i ) );
+            field.redraw();
+            app.commit();
+        } );
+
+        measure( "Label construction", 5000, [&]( int i ) {
+            app.begin_frame();
+            Label label( "label " + std::to_string( i ) );
+            label.redraw();
+            app.commit();
+        } );
+
+        Button< bool > button( "OK", true );
+
+        measure( "Button::focus/unfocus", 20000, [&]( int i ) {
+            app.begin_frame();
+            if( i % 2 ) button.focus();
+            else button.unfocus();
+            app.commit();
+        } );
+
+        StaticButton< Constant< bool > > fixed( "OK", true );
+
+        measure( "StaticButton::focus/unfocus", 20000, [&]( int i ) {
+            app.begin_frame();
+            if( i % 2 ) fixed.focus();
+            else fixed.unfocus();
+            app.commit();
+        } );
+
+        /* a menu's worth of buttons built and torn down in one frame */
+        measure( "Button construction (x100)", 200, [&]( int ) {
+            app.begin_frame();
+            std::vector< std::unique_ptr< Button< int > > > menu;
+            for( int item = 0; item < 100; ++item )
+                menu.emplace_back( new Button< int >( "item",
+                            [item]{ return item; } ) );
+            app.commit();
+        } );
+
+        measure( "StaticButton construction (x100)", 200, [&]( int ) {
+            struct Pick {
+                int item;
+                int operator()() const { return item; }
+            };
+
+            app.begin_frame();
+            std::vector< std::unique_ptr< StaticButton< Pick > > > menu;
+            for( int item = 0; item < 100; ++item )
+                menu.emplace_back( new StaticButton< Pick >( "item",
+                            Pick{ item } ) );
+            app.commit();
+        } );
+
+        Widget framed( Geometry( 10, 40 ), Anchor( 30, 100 ), BorderStyle() );
+        const BorderStyle styles[] = {
+            BorderStyle( '|', '-' ), BorderStyle( '#', '=' ) };
+
+        measure( "Border::set (decorate)", 20000, [&]( int i ) {
+            app.begin_frame();
+            framed.decorate( styles[ i % 2 ] );
+            framed.redraw();
+            app.commit();
+        } );
+    }
+
+    /*
+     * A screen of 240 widgets in 12 rows of 20, relaid out either entirely
+     * (the screen changes size) or after one item's constraint changed.
+     */
+    void layout( Application& app ) {
+        header( "layout (240 widgets)" );
+
+        std::vector< std::unique_ptr< Widget > > cells;
+        Layout screen( Layout::column );
+        std::vector< Layout* > rows;
+
+        for( int r = 0; r < 12; ++r ) {
+            rows.push_back( &screen.nest( Layout::row ) );
+            for( int c = 0; c < 20; ++c ) {
+                cells.emplace_back( new Widget( Geometry( 2, 5 ) ) );
+                rows.back()->add( *cells.back() );
+            }
+        }
+
+        screen.update();
+
+        measure( "full relayout", 500, [&]( int i ) {
+            app.begin_frame();
+            screen.place( 0, 0, lines - i % 2, cols - i % 2 );
+            screen.update();
+            app.commit();
+        } );
+
+        measure( "one constraint changed", 5000, [&]( int i ) {
+            app.begin_frame();
+            rows[ i % 12 ]->constrain( i % 20, Constraint( 1 + i % 2 ) );
+            screen.update();
+            app.commit();
+        } );
+    }
+
+    /*
+     * Hit-testing and arrow key focus moves over a 50x100 grid of 5000
+     * focusable cells, as in a large menu or a grid of buttons.
+     */
+    void spatial() {
+        header( "spatial index (5000 cells)" );
+
+        SpatialIndex index;
+        for( int r = 0; r < 50; ++r )
+            for( int c = 0; c < 100; ++c )
+                index.add( r, c * 2, 1, 2, nullptr, []( bool ) {} );
+
+        SpatialIndex::Id hit = 0;
+        measure( "SpatialIndex::at", 1000000, [&]( int i ) {
+            hit ^= index.at( i % 50, ( i * 7 ) % 200 );
+        } );
+
+        const int keys[] = { KEY_RIGHT, KEY_DOWN, KEY_LEFT, KEY_UP };
+        measure( "SpatialIndex::navigate", 1000000, [&]( int i ) {
+            index.navigate( keys[ ( i / 37 ) % 4 ] );
+        } );
+
+        /* every cell shifts one column over and back */
+        measure( "SpatialIndex::move", 1000000, [&]( int i ) {
+            index.move( i % 5000, ( i / 100 ) % 50,
+                    ( i % 100 ) * 2 + ( i / 5000 ) % 2, 1, 2 );
+        } );
+
+        if( hit == SpatialIndex::none ) std::printf( "(nothing hit)\n" );
+    }
+
+    /*
+     * A heatmap recolouring every cell of a 20x60 widget per frame, with
+     * more distinct colours in play than fit in the pair cache at once.
+     */
+    void heatmap( Application& app ) {
+        header( "heatmap (1200 cells per frame)" );
+
+        Widget map( Geometry( 20, 60 ), Anchor( 0, 0 ) );
+
+        measure( "Color::index", 1000000, [&]( int i ) {
+            if( Color( i & 255, ( i >> 8 ) & 255, i >> 16 ).index() < -1 )
+                std::printf( "(bad index)\n" );
+        } );
+
+        measure( "recolour frame", 500, [&]( int i ) {
+            app.begin_frame();
+            for( int y = 0; y < 20; ++y ) {
+                for( int x = 0; x < 60; ++x ) {
+                    const unsigned heat = ( x * 4 + y * 3 + i ) & 255;
+                    const Format cell( map, Color( heat, 0, 255 - heat ) );
+                    map.put( '#', y, x );
+                }
+            }
+            map.redraw();
+            app.commit();
+        } );
+    }
+
+    /*
+     * A table of a million rows: scrolling and editing touch only the rows
+     * in view, and sorting runs on the worker while the UI keeps drawing.
+     */
+    void table( Application& app ) {
+        header( "table (1M rows, 4 columns)" );
+
+        Table table( { "id", "name", "size", "state" },
+                Geometry( 40, 120 ), Anchor( 0, 0 ) );
+
+        std::mt19937 random( 42 );
+        std::uniform_int_distribution< int > size( 0, 1 << 30 );
+        const char* const states[] = { "queued", "running", "done", "failed" };
+
+        measure( "add 1000 rows", 1000, [&]( int ) {
+            char id[ 16 ], name[ 32 ], bytes[ 16 ];
+            for( int n = 0; n < 1000; ++n ) {
+                const std::size_t row = table.rows();
+                const int a = std::snprintf( id, sizeof( id ), "%zu", row );
+                const int b = std::snprintf( name, sizeof( name ),
+                        "job-%08x", unsigned( random() ) );
+                const int c = std::snprintf( bytes, sizeof( bytes ),
+                        "%d", size( random ) );
+                table.add( { Text( id, a ), Text( name, b ),
+                        Text( bytes, c ), states[ row % 4 ] } );
+            }
+        } );
+
+        measure( "page down, one frame", 5000, [&]( int ) {
+            app.begin_frame();
+            table.page_down();
+            table.redraw();
+            app.commit();
+        } );
+
+        char value[ 32 ];
+        measure( "set one cell, one frame", 20000, [&]( int i ) {
+            const int len = std::snprintf( value, sizeof( value ), "%d", i );
+            app.begin_frame();
+            table.set( table.row_at( table.listed() - 1 ), 2,
+                    Text( value, len ) );
+            table.redraw();
+            app.commit();
+        } );
+
+        /* the UI thread idles between frames, as it would waiting for input */
+        measure( "sort, frames until swapped in", 5, [&]( int i ) {
+            table.sort( 2, i % 2 );
+            while( table.busy() ) {
+                std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+                app.begin_frame();
+                table.redraw();
+                app.commit();
+            }
+        } );
+
+        measure( "filter, frames until swapped in", 5, [&]( int i ) {
+            table.filter( 3, i % 2 ? "run" : "" );
+            while( table.busy() ) {
+                std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+                app.begin_frame();
+                table.redraw();
+                app.commit();
+            }
+        } );
+    }
+
+    /*
+     * A selector over 2M metric names, e.g. "api.cache.hits.p99". A new
+     * query searches every name; a longer one only the names it matched.
+     */
+    void selector( Application& app ) {
+        header( "selector (2M metric names)" );
+
+        Selector selector( "metric> ", Geometry( 40, 120 ), Anchor( 0, 0 ) );
+
+        std::mt19937 random( 42 );
+        const char* const parts[] = {
+            "api", "db", "cache", "queue", "http", "disk", "net", "cpu",
+            "memory", "requests", "errors", "latency", "hits", "misses",
+            "bytes", "gc" };
+
+        measure( "add 1000 names", 2000, [&]( int ) {
+            char name[ 64 ];
+            for( int n = 0; n < 1000; ++n ) {
+                const int len = std::snprintf( name, sizeof( name ),
+                        "%s.%s.%s.p%u", parts[ random() % 16 ],
+                        parts[ random() % 16 ], parts[ random() % 16 ],
+                        unsigned( random() % 100 ) );
+                selector.add( Text( name, len ) );
+            }
+        } );
+
+        const auto settle = [&] {
+            while( selector.busy() ) {
+                std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+                app.begin_frame();
+                selector.redraw();
+                app.commit();
+            }
+        };
+
+        /* what the UI thread does per key, whatever the search is doing */
+        measure( "typing, one frame", 20000, [&]( int i ) {
+            selector.key( i % 2 ? KEY_BACKSPACE : 'a' + i % 26 );
+            app.begin_frame();
+            selector.redraw();
+            app.commit();
+        } );
+        settle();
+
+        measure( "new query, frames until swapped in", 5, [&]( int i ) {
+            selector.search( std::string( 1, "chdlq"[ i % 5 ] ) );
+            settle();
+        } );
+
+        measure( "refined query, frames until in", 5, [&]( int i ) {
+            selector.search( i % 2 ? "cachehit" : "cachehitp9" );
+            settle();
+        } );
+
+        selector.search( "e" );
+        settle();
+        measure( "page down, one frame", 5000, [&]( int ) {
+            selector.key( KEY_NPAGE );
+            app.begin_frame();
+            selector.redraw();
+            app.commit();
+        } );
+        settle();
+    }
+
+    /*
+     * A chart of 100k samples taking 10k samples per second: pushes are
+     * measured on their own, and a frame decimates the whole ring.
+     */
+    void chart( Application& app ) {
+        header( "chart (100k samples, 20x160)" );
+
+        Chart chart( 100000, Geometry( 20, 160 ), Anchor( 0, 0 ) );
+
+        measure( "Chart::push", 10000000, [&]( int i ) {
+            chart.push( ( i % 1000 ) * 7919 % 1000 );
+        } );
+
+        measure( "bars, one frame", 2000, [&]( int i ) {
+            for( int n = 0; n < 166; ++n ) chart.push( ( i * n ) % 1000 );
+            app.begin_frame();
+            chart.redraw();
+            app.commit();
+        } );
+
+        chart.style( Chart::dots );
+        measure( "dots, one frame", 2000, [&]( int i ) {
+            for( int n = 0; n < 166; ++n ) chart.push( ( i * n ) % 1000 );
+            app.begin_frame();
+            chart.redraw();
+            app.commit();
+        } );
+    }
+
+    /*
+     * Typing into the middle of a long line, and completing hostnames from
+     * 100k of them as the operator console does.
+     */
+    void editor( Application& app ) {
+        header( "editor (4 KiB line, 100k words)" );
+
+        Editor editor( 100, Geometry( 1, 80 ), Anchor( 0, 0 ) );
+        editor.focus();
+        editor.set( std::string( 4096, 'x' ) );
+        for( int n = 0; n < 2048; ++n ) editor.key( KEY_LEFT );
+
+        measure( "Editor::key, mid-line", 1000000, [&]( int i ) {
+            editor.key( i % 2 ? KEY_BACKSPACE : 'a' + i % 26 );
+        } );
+
+        measure( "typing, one frame", 20000, [&]( int i ) {
+            editor.key( i % 2 ? KEY_BACKSPACE : 'a' + i % 26 );
+            app.begin_frame();
+            editor.redraw();
+            app.commit();
+        } );
+
+        std::mt19937 random( 42 );
+        std::uniform_int_distribution< int > rack( 0, 999 );
+        std::vector< std::string > hosts;
+        for( int i = 0; i < 100000; ++i )
+            hosts.push_back( "node" + std::to_string( rack( random ) )
+                    + "-" + std::to_string( i ) + ".dc"
+                    + std::to_string( i % 7 ) + ".example.net" );
+
+        Trie words;
+        measure( "Trie::add", hosts.size() - 1, [&]( int i ) {
+            words.add( hosts[ i ] );
+        } );
+
+        std::vector< std::string > found;
+        measure( "Trie::complete (10 of a prefix)", 1000000, [&]( int i ) {
+            const std::string& host = hosts[ i % hosts.size() ];
+            words.complete( Text( host.data(), 2 + i % 6 ), 10, found );
+        } );
+
+        editor.completions( &words );
+        measure( "Tab, one frame", 20000, [&]( int i ) {
+            editor.set( hosts[ i % hosts.size() ].substr( 0, 7 ) );
+            editor.key( '\t' );
+            app.begin_frame();
+            editor.redraw();
+            app.commit();
+        } );
+    }
+
+#if __cplusplus >= 202002L
+    Task<> ticker( Application& app, const int ticks, int& left ) {
+        for( int i = 0; i < ticks; ++i )
+            co_await app.sleep( std::chrono::milliseconds( 0 ) );
+        if( --left == 0 ) app.quit();
+    }
+
+    Task<> press( Button< int >& button, long& sum ) {
+        sum += co_await button.pressed();
+    }
+
+    /*
+     * Tasks on the event loop: many coroutines taking turns through the timer
+     * heap, and one suspended on a button per press. Only built with C++20.
+     */
+    void tasks( Application& app ) {
+        header( "tasks (10k coroutines)" );
+
+        measure( "10k tasks x 10 sleeps, run", 20, [&]( int ) {
+            int left = 10000;
+            for( int n = 0; n < 10000; ++n )
+                app.spawn( ticker( app, 10, left ) );
+            app.run();
+        } );
+
+        Button< int > button( "OK", [] { return 1; } );
+        long sum = 0;
+        measure( "spawn, await pressed, trigger", 1000000, [&]( int ) {
+            app.spawn( press( button, sum ) );
+            button.trigger();
+        } );
+    }
+#endif
+
+    /*
+     * Text measurement for Textfield::text_wrap over random lines of up to
+     * 120 characters.
+     */
+    void measurement() {
+        header( "LineIndex (text measurement)" );
+
+        std::mt19937 random( 42 );
+        std::uniform_int_distribution< int > length( 0, 120 );
+
+        const std::size_t sizes[] = {
+            1 << 10, 64 << 10, 1 << 20, 16 << 20, 100 << 20 };
+
+        for( const std::size_t size : sizes ) {
+            std::string text;
+            text.reserve( size );
+            while( text.size() < size ) {
+                text.append( length( random ), 'x' );
+                text.push_back( '\n' );
+            }
+            text.resize( size );
+
+            const int iterations = std::max< int >( 1, ( 256 << 20 ) / size );
+            std::size_t seen = 0;
+
+            const std::string name = "measure " + std::to_string( size >> 10 )
+                + " KiB";
+
+            measure( name.c_str(), iterations, [&]( int ) {
+                const LineIndex index( text );
+                seen += index.lines() + index.longest();
+            } );
+
+            if( seen == 0 ) std::printf( "(nothing measured)\n" );
+        }
+
+        /* the same lines, with every fourth character outside ASCII */
+        std::string text;
+        while( text.size() < ( 1 << 20 ) ) {
+            for( int n = length( random ) / 4; n > 0; --n ) text += "abcé";
+            text.push_back( '\n' );
+        }
+
+        std::size_t seen = 0;
+        measure( "measure 1024 KiB (UTF-8)", 256, [&]( int ) {
+            const LineIndex index( text );
+            seen += index.lines() + index.longest();
+        } );
+
+        if( seen == 0 ) std::printf( "(nothing measured)\n" );
+    }
+}
+
+int main() {
+    std::setlocale( LC_CTYPE, "C.UTF-8" );
+    setenv( "LINES", std::to_string( lines ).c_str(), 1 );
+    setenv( "COLUMNS", std::to_string( cols ).c_str(), 1 );
+
+    sink = std::tmpfile();
+    FILE* input = std::fopen( "/dev/null", "r" );
+    if( !sink || !input ) {
+        std::perror( "benchmark" );
+        return EXIT_FAILURE;
+    }
+
+    {
+        Application app( sink, input, terminal );
+        dashboard( app, "dashboard (60 textfields)" );
+
+        Renderer renderer( fileno( sink ) );
+        app.render( &renderer );
+        dashboard( app, "dashboard, own renderer" );
+        app.render( nullptr );
+
+        widgets( app );
+        layout( app );
+        heatmap( app );
+        table( app );
+        selector( app );
+        chart( app );
+        editor( app );
+#if __cplusplus >= 202002L
+        tasks( app );
+#endif
+    }
+
+    spatial();
+    measurement();
+
+    std::fclose( input );
+    std::fclose( sink );
+    return EXIT_SUCCESS;
+}
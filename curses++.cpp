@@ -1,14 +1,387 @@
 #include <algorithm>
+#include <cerrno>
+#include <clocale>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#ifndef NCURSES_WIDECHAR
+#define NCURSES_WIDECHAR 1
+#endif
 #include <ncurses.h>
 #include <string>
+#include <system_error>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 #include "curses++.h"
 
+#if defined( __SSE2__ ) || defined( __AVX__ ) || defined( __AVX2__ )
+#include <immintrin.h>
+#endif
+
+/*
+ * The open frames of every live Application, in the order they were built.
+ * Widgets go by the last one's: while it has frames open, windows are only
+ * staged on the virtual screen and the terminal is updated once by the
+ * outermost commit. Destroying an Application hands this back to the one
+ * built before it. (curses offers no way to ask which screen is current;
+ * delscreen() even clears stdscr.)
+ */
+static std::vector< const int* > frame_depths;
+
+static bool in_frame() {
+    return !frame_depths.empty() && *frame_depths.back() > 0;
+}
+
+#ifdef CURSESXX_STATS
+static std::vector< cursesxx::Probe* > probes;
+static cursesxx::Counters totals;
+static cursesxx::Counters frame_totals;
+static cursesxx::Counters last_frame;
+static unsigned long frames = 0;
+static std::vector< unsigned long > frame_times( 32 );
+static std::chrono::steady_clock::time_point frame_start;
+#endif
+
+/* Renders instead of doupdate() when set, see Application::render */
+static cursesxx::Renderer* backend = nullptr;
+
+/* Set when the panel stack changed inside a frame, see Application::commit */
+static bool restacked = false;
+
+/*
+ * Brings the terminal up to date with the panel stack. Inside a frame this
+ * is left to the outermost commit, so the stack is composed once per frame.
+ */
+static void restack() {
+    if( in_frame() ) {
+        restacked = true;
+        return;
+    }
+
+    update_panels();
+    if( backend ) backend->present();
+    else doupdate();
+}
+
+/* Whether any panel stacked above (or below) overlaps this one */
+static bool overlapped( PANEL* panel, PANEL* ( *next )( const PANEL* ) ) {
+    WINDOW* win = panel_window( panel );
+    int top, left, height, width;
+    getbegyx( win, top, left );
+    getmaxyx( win, height, width );
+
+    for( PANEL* other_panel = next( panel ); other_panel;
+            other_panel = next( other_panel ) ) {
+
+        WINDOW* other = panel_window( other_panel );
+        int y, x, h, w;
+        getbegyx( other, y, x );
+        getmaxyx( other, h, w );
+
+        if( y < top + height && top < y + h && x < left + width && left < x + w )
+            return true;
+    }
+
+    return false;
+}
+
+/*
+ * Whether any two panels overlap at all, worked out again only after the
+ * stack changed. Widgets side by side, the common case, then never need a
+ * walk over the stack.
+ */
+static bool stack_changed = true;
+static bool stack_layered = false;
+
+static void reorder() {
+    stack_changed = true;
+    restack();
+}
+
+static bool covered( PANEL* panel ) {
+    if( stack_changed ) {
+        stack_changed = false;
+        stack_layered = false;
+
+        for( PANEL* p = panel_above( nullptr ); p && !stack_layered;
+                p = panel_above( p ) )
+            stack_layered = overlapped( p, panel_above );
+    }
+
+    return stack_layered && overlapped( panel, panel_above );
+}
+
+/*
+ * Windows reach the screen through their panel. A view shares its cells
+ * with the window it is part of, so only its changes have to be passed up.
+ *
+ * A panel that nothing overlaps from above is copied to the virtual screen
+ * directly, which is all update_panels would do for it. Views, whose panel
+ * is not known here, have the whole stack composed.
+ */
+static void stage( WINDOW* win, PANEL* panel ) {
+    if( wgetparent( win ) ) wsyncup( win );
+
+    /* the whole stack is composed by the frame's commit anyway */
+    if( restacked ) return;
+    if( panel && panel_hidden( panel ) == TRUE ) return;
+
+    if( !panel || covered( panel ) ) {
+        restack();
+        return;
+    }
+
+    wnoutrefresh( panel_window( panel ) );
+    if( in_frame() ) return;
+
+    if( backend ) backend->present();
+    else doupdate();
+}
+
 WINDOW* cursesxx::Format::get_win( const Widget& widget ) {
     return widget.window.get();
 }
 
+/*
+ * COLOR_PAIR() keeps only 8 bits of the pair, so the pair is set on its
+ * own, given in full through opts where curses has extended colours. The
+ * pair it replaces is set again when the Format goes.
+ */
+void cursesxx::Format::set_pair() {
+    attr_t attrs;
+    short pair;
+
+#if NCURSES_EXT_COLORS
+    wattr_get( this->win, &attrs, &pair, &this->previous );
+    wcolor_set( this->win, pair, &this->pair );
+#else
+    wattr_get( this->win, &attrs, &pair, nullptr );
+    this->previous = pair;
+    wcolor_set( this->win, this->pair, nullptr );
+#endif
+}
+
 cursesxx::Format::~Format() {
-    wattroff( this->win, this->bitmask );
+    if( this->pair < 0 ) {
+        wattroff( this->win, this->bitmask );
+        return;
+    }
+
+#if NCURSES_EXT_COLORS
+    wcolor_set( this->win, 0, &this->previous );
+#else
+    wcolor_set( this->win, this->previous, nullptr );
+#endif
+}
+
+/*
+ * COLOR
+ */
+
+/*
+ * RGB is quantised to 5 bits per channel; the tables map each of those 32768
+ * cells to the nearest terminal colour, measured from the cell's centre.
+ */
+static int cell( unsigned int R, unsigned int G, unsigned int B ) {
+    return ( std::min( R, 255u ) >> 3 << 10 )
+        | ( std::min( G, 255u ) >> 3 << 5 )
+        | ( std::min( B, 255u ) >> 3 );
+}
+
+static int distance( int r1, int g1, int b1, int r2, int g2, int b2 ) {
+    return ( r1 - r2 ) * ( r1 - r2 )
+        + ( g1 - g2 ) * ( g1 - g2 )
+        + ( b1 - b2 ) * ( b1 - b2 );
+}
+
+/*
+ * The xterm 256 colour palette past the 16 basic colours is a 6x6x6 cube
+ * and a 24 step grey ramp, so the nearest entry is found per channel rather
+ * than by comparing against all of them.
+ */
+static const std::vector< unsigned char >& xterm256() {
+    static std::vector< unsigned char > table;
+    if( !table.empty() ) return table;
+
+    static const int levels[] = { 0, 95, 135, 175, 215, 255 };
+    table.resize( 1 << 15 );
+
+    for( int i = 0; i < ( 1 << 15 ); ++i ) {
+        const int r = ( ( i >> 10 ) << 3 ) + 4;
+        const int g = ( ( ( i >> 5 ) & 31 ) << 3 ) + 4;
+        const int b = ( ( i & 31 ) << 3 ) + 4;
+
+        int cube[ 3 ];
+        const int rgb[ 3 ] = { r, g, b };
+        for( int c = 0; c < 3; ++c ) {
+            cube[ c ] = 0;
+            for( int l = 1; l < 6; ++l )
+                if( std::abs( levels[ l ] - rgb[ c ] )
+                        < std::abs( levels[ cube[ c ] ] - rgb[ c ] ) )
+                    cube[ c ] = l;
+        }
+
+        const int grey = std::min( 23, std::max( 0,
+                    ( ( r + g + b ) / 3 - 3 ) / 10 ) );
+        const int level = 8 + 10 * grey;
+
+        const int to_cube = distance( r, g, b,
+                levels[ cube[ 0 ] ], levels[ cube[ 1 ] ], levels[ cube[ 2 ] ] );
+        const int to_grey = distance( r, g, b, level, level, level );
+
+        table[ i ] = to_grey < to_cube
+            ? 232 + grey
+            : 16 + 36 * cube[ 0 ] + 6 * cube[ 1 ] + cube[ 2 ];
+    }
+
+    return table;
+}
+
+static const std::vector< unsigned char >& basic16() {
+    static std::vector< unsigned char > table;
+    if( !table.empty() ) return table;
+
+    static const int palette[ 16 ][ 3 ] = {
+        {   0,   0,   0 }, { 205,   0,   0 }, {   0, 205,   0 },
+        { 205, 205,   0 }, {   0,   0, 238 }, { 205,   0, 205 },
+        {   0, 205, 205 }, { 229, 229, 229 }, { 127, 127, 127 },
+        { 255,   0,   0 }, {   0, 255,   0 }, { 255, 255,   0 },
+        {  92,  92, 255 }, { 255,   0, 255 }, {   0, 255, 255 },
+        { 255, 255, 255 } };
+
+    table.resize( 1 << 15 );
+    for( int i = 0; i < ( 1 << 15 ); ++i ) {
+        const int r = ( ( i >> 10 ) << 3 ) + 4;
+        const int g = ( ( ( i >> 5 ) & 31 ) << 3 ) + 4;
+        const int b = ( ( i & 31 ) << 3 ) + 4;
+
+        int best = 0;
+        for( int c = 1; c < 16; ++c )
+            if( distance( r, g, b, palette[ c ][ 0 ], palette[ c ][ 1 ],
+                        palette[ c ][ 2 ] )
+                    < distance( r, g, b, palette[ best ][ 0 ],
+                        palette[ best ][ 1 ], palette[ best ][ 2 ] ) )
+                best = c;
+
+        table[ i ] = best;
+    }
+
+    return table;
+}
+
+/*
+ * Colour pairs in least-recently-used order. Pair numbers are the list
+ * nodes; slot[ key ] is the pair holding a (fg, bg) combination, if any, so
+ * both hits and evictions are constant time.
+ */
+namespace {
+    class Pairs {
+        public:
+            int get( int fg, int bg );
+            void reset();
+
+        private:
+            static const int colours = 257;
+
+            int capacity = 0;
+            int used = 0;
+            std::vector< int > slot;
+            std::vector< int > key;
+            std::vector< int > prev, next;
+
+            void unlink( int pair );
+            void push_front( int pair );
+    };
+
+    Pairs pairs;
+}
+
+/* Without extended colours a pair has to fit the 8 bits of COLOR_PAIR() */
+void Pairs::reset() {
+#if NCURSES_EXT_COLORS
+    this->capacity = std::min( COLOR_PAIRS - 1, 32767 );
+#else
+    this->capacity = std::min( COLOR_PAIRS - 1, 255 );
+#endif
+    this->used = 0;
+    this->slot.assign( colours * colours, 0 );
+    this->key.assign( this->capacity + 1, 0 );
+
+    /* node 0 is the list head; next[ 0 ] is the most recently used pair */
+    this->prev.assign( this->capacity + 1, 0 );
+    this->next.assign( this->capacity + 1, 0 );
+}
+
+void Pairs::unlink( int pair ) {
+    this->next[ this->prev[ pair ] ] = this->next[ pair ];
+    this->prev[ this->next[ pair ] ] = this->prev[ pair ];
+}
+
+void Pairs::push_front( int pair ) {
+    this->prev[ pair ] = 0;
+    this->next[ pair ] = this->next[ 0 ];
+    this->prev[ this->next[ 0 ] ] = pair;
+    this->next[ 0 ] = pair;
+}
+
+int Pairs::get( int fg, int bg ) {
+    if( this->capacity <= 0 ) return 0;
+
+    const int k = ( fg + 1 ) * colours + ( bg + 1 );
+    int pair = this->slot[ k ];
+
+    if( pair ) {
+        this->unlink( pair );
+        this->push_front( pair );
+        return pair;
+    }
+
+    if( this->used < this->capacity ) {
+        pair = ++this->used;
+    } else {
+        pair = this->prev[ 0 ];
+        this->unlink( pair );
+        this->slot[ this->key[ pair ] ] = 0;
+    }
+
+    init_pair( pair, fg, bg );
+    this->slot[ k ] = pair;
+    this->key[ pair ] = k;
+    this->push_front( pair );
+    return pair;
+}
+
+cursesxx::Color::Color() :
+    R( 0 ), G( 0 ), B( 0 ),
+    terminal_default( true )
+{}
+
+cursesxx::Color::Color( unsigned int R, unsigned int G, unsigned int B ) :
+    R( R ), G( G ), B( B ),
+    terminal_default( false )
+{}
+
+/* The terminal's colour number, or -1 for the default colour */
+int cursesxx::Color::index() const {
+    if( this->terminal_default ) return -1;
+
+    const int i = cell( this->R, this->G, this->B );
+    if( COLORS >= 256 ) return xterm256()[ i ];
+    if( COLORS >= 16 ) return basic16()[ i ];
+    return basic16()[ i ] % 8;
+}
+
+int cursesxx::Color::pair( const Color& fg, const Color& bg ) {
+    if( !has_colors() ) return 0;
+    return pairs.get( fg.index(), bg.index() );
 }
 
 cursesxx::BorderStyle::BorderStyle() : 
@@ -38,22 +411,33 @@ cursesxx::BorderStyle::BorderStyle( char ls, char rs, char ts,
     bl( bl ), br( br )
 {}
 
+bool cursesxx::BorderStyle::operator==( const BorderStyle& other ) const {
+    return this->detailed == other.detailed
+        && this->ls == other.ls && this->rs == other.rs
+        && this->ts == other.ts && this->bs == other.bs
+        && this->tl == other.tl && this->tr == other.tr
+        && this->bl == other.bl && this->br == other.br;
+}
+
+bool cursesxx::BorderStyle::operator!=( const BorderStyle& other ) const {
+    return !( *this == other );
+}
+
 cursesxx::Border::Border() : win( nullptr )
 {}
 
-cursesxx::Border::Border( WINDOW* win ) : win( win ) {
-    box( win, '|', '-' );
-}
+cursesxx::Border::Border( WINDOW* win ) :
+    Border( win, BorderStyle( '|', '-' ) )
+{}
 
-cursesxx::Border::Border( WINDOW* win, char vert, char hor ) : win( win ) {
-    box( win, vert, hor );
-}
+cursesxx::Border::Border( WINDOW* win, char vert, char hor ) :
+    Border( win, BorderStyle( vert, hor ) )
+{}
 
 cursesxx::Border::Border( WINDOW* win, char ls, char rs, char ts,
-        char bs, char tl, char tr, char bl, char br ) : win( win ) {
-
-    wborder( win, ls, rs, ts, bs, tl, tr, bl, br );
-}
+        char bs, char tl, char tr, char bl, char br ) :
+    Border( win, BorderStyle( ls, rs, ts, bs, tl, tr, bl, br ) )
+{}
 
 static WINDOW* draw_border( WINDOW* win, const cursesxx::BorderStyle& proto ) {
     if( !proto.detailed )
@@ -66,22 +450,41 @@ static WINDOW* draw_border( WINDOW* win, const cursesxx::BorderStyle& proto ) {
 }
 
 cursesxx::Border::Border( WINDOW* win, const BorderStyle& proto ) :
-    win( draw_border( win, proto ) )
+    win( draw_border( win, proto ) ),
+    style( new BorderStyle( proto ) )
 {}
 
-void cursesxx::Border::set( const cursesxx::BorderStyle& style ) {
+/*
+ * Draws the border in the given style, unless that is the style already
+ * drawn. Every border cell is overwritten, so the old border needs no
+ * blanking first. Returns whether anything was drawn.
+ */
+bool cursesxx::Border::set( const cursesxx::BorderStyle& style ) {
     /* Cannot set border unless set during encapsulation object construction */
-    if( this->win == nullptr ) return; 
+    if( this->win == nullptr ) return false;
+    if( this->style && *this->style == style ) return false;
 
     draw_border( this->win, style );
+    this->style.reset( new BorderStyle( style ) );
+    return true;
 }
 
-void cursesxx::Border::set( const cursesxx::BorderStyle&& style ) {
-    /* Cannot set border unless set during encapsulation object construction */
-    if( this->win == nullptr ) return; 
+bool cursesxx::Border::set( const cursesxx::BorderStyle&& style ) {
+    return this->set( style );
+}
 
-    wborder( this->win, ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ' );
-    draw_border( this->win, style );
+bool cursesxx::Border::drawn() const {
+    return this->win != nullptr;
+}
+
+/*
+ * Draws the current style again into win, which from now on is the border's
+ * window; the frame may have been resized or replaced.
+ */
+void cursesxx::Border::draw( WINDOW* win ) {
+    if( this->win == nullptr || !this->style ) return;
+
+    this->win = draw_border( win, *this->style );
 }
 
 cursesxx::Border::~Border() {
@@ -119,14 +522,22 @@ int cursesxx::Geometry::width() const {
     return this->width_;
 }
 
+void cursesxx::Geometry::set_height( int height ) {
+    this->height_ = height;
+}
+
+void cursesxx::Geometry::set_width( int width ) {
+    this->width_ = width;
+}
+
 cursesxx::Anchor::Anchor( const bool border ) :
     y( border ? 1 : 0 ),
     x( border ? 1 : 0 )
 {}
 
 cursesxx::Anchor::Anchor( const int y, const int x, const bool border ) :
-    y( y + border ? 1 : 0 ),
-    x( x + border ? 1 : 0 )
+    y( y + ( border ? 1 : 0 ) ),
+    x( x + ( border ? 1 : 0 ) )
 {}
 
 cursesxx::Anchor::Anchor( const Anchor& base, const Anchor& offset ) :
@@ -134,313 +545,5438 @@ cursesxx::Anchor::Anchor( const Anchor& base, const Anchor& offset ) :
     x( base.x + offset.x )
 {}
 
-cursesxx::Widget::Widget() :
-    window( newwin(
-                this->geometry.height(),
-                this->geometry.width(),
-                this->anchor.y,
-                this->anchor.x ) )
-{}
+/*
+ * Whether text[0, len) is all ASCII, tested a vector at a time. ASCII text,
+ * by far the common case, keeps the narrow curses calls and is measured in
+ * bytes, as it was before UTF-8 was supported.
+ */
+static bool ascii( const char* text, std::size_t len ) {
+    std::size_t pos = 0;
 
-cursesxx::Widget::Widget( const Geometry& g ) :
-    geometry( g ),
-    window( newwin(
-                g.height(),
-                g.width(),
-                this->anchor.y,
-                this->anchor.x ) )
-{}
+#if defined( __AVX2__ )
+    for( ; pos + 32 <= len; pos += 32 ) {
+        const __m256i chunk = _mm256_loadu_si256(
+                reinterpret_cast< const __m256i* >( text + pos ) );
+        if( _mm256_movemask_epi8( chunk ) ) return false;
+    }
+#endif
 
-cursesxx::Widget::Widget( const Anchor& a ) :
-    anchor( a ),
-    window( newwin(
-                this->geometry.height(),
-                this->geometry.width(),
-                a.y,
-                a.x ) )
-{}
+#if defined( __SSE2__ )
+    for( ; pos + 16 <= len; pos += 16 ) {
+        const __m128i chunk = _mm_loadu_si128(
+                reinterpret_cast< const __m128i* >( text + pos ) );
+        if( _mm_movemask_epi8( chunk ) ) return false;
+    }
+#endif
 
-cursesxx::Widget::Widget( const BorderStyle& b ) :
-    geometry( true ),
-    anchor( true ),
-    window( newwin(
-                this->geometry.height() + 2,
-                this->geometry.width() + 2,
-                this->anchor.y - 1,
-                this->anchor.x - 1 ) ),
-    decoration( this->window.get(), b )
-{}
+    for( ; pos < len; ++pos )
+        if( static_cast< unsigned char >( text[ pos ] ) >= 0x80 ) return false;
 
-cursesxx::Widget::Widget( const Geometry& g, const Anchor& a ) :
-    geometry( g ),
-    anchor( a ),
-    window( newwin( 
-                g.height(),
-                g.width(),
-                a.y,
-                a.x ) )
-{}
+    return true;
+}
 
-cursesxx::Widget::Widget( const Geometry& g, const BorderStyle& b ) :
-    geometry( g ),
-    anchor( true ),
-    window( newwin(
-                g.height() + 2,
-                g.width() + 2,
-                this->anchor.y - 1,
-                this->anchor.x - 1 ) ),
-    decoration( this->window.get(), b )
-{}
+/* Whether c continues a UTF-8 sequence rather than starting one */
+static bool continuation( char c ) {
+    return ( static_cast< unsigned char >( c ) & 0xC0 ) == 0x80;
+}
 
-cursesxx::Widget::Widget( const Anchor& a, const BorderStyle& b ) :
-    geometry( true ),
-    anchor( a ),
-    window( newwin( 
-                this->geometry.height() + 2,
-                this->geometry.width() + 2,
-                a.y - 1,
-                a.x - 1 ) ),
-    decoration( this->window.get(), b )
-{}
+/* Whether c is a character by itself, an ASCII one */
+static bool plain( char c ) {
+    return static_cast< unsigned char >( c ) < 0x80;
+}
 
-cursesxx::Widget::Widget( const Geometry& g,
-        const Anchor& a, const BorderStyle& b ) :
-    geometry( g ),
-    anchor( a ),
-    window( newwin( 
-                g.height() + 2,
-                g.width() + 2,
-                a.y - 1,
-                a.x - 1 ) ),
-    decoration( this->window.get(), b )
-{}
+/*
+ * Decodes the UTF-8 sequence at text[pos] into c and returns its length in
+ * bytes. A malformed or truncated sequence decodes as U+FFFD, one byte at a
+ * time.
+ */
+static std::size_t decode( const char* text, std::size_t len,
+        std::size_t pos, wchar_t& c ) {
 
-cursesxx::Widget::Widget( const Widget& parent ) :
-    geometry( parent.geometry ),
-    anchor( parent.anchor ),
-    window( newwin( 
-                this->geometry.height(),
-                this->geometry.width(),
-                this->anchor.y,
-                this->anchor.x ) ),
-    decoration( this->window.get() )
-{}
+    const unsigned char* s =
+        reinterpret_cast< const unsigned char* >( text + pos );
+    const unsigned char lead = s[ 0 ];
 
-cursesxx::Widget::Widget( const Widget& parent, const Geometry& g ) :
-    geometry( g ),
-    anchor( parent.anchor ),
-    window( newwin(
-                g.height(),
-            g.width(),
-            this->anchor.y,
-            this->anchor.x ) )
-{}
+    std::size_t n;
+    if( lead < 0x80 ) { c = lead; return 1; }
+    else if( ( lead & 0xE0 ) == 0xC0 ) { n = 2; c = lead & 0x1F; }
+    else if( ( lead & 0xF0 ) == 0xE0 ) { n = 3; c = lead & 0x0F; }
+    else if( ( lead & 0xF8 ) == 0xF0 ) { n = 4; c = lead & 0x07; }
+    else { c = 0xFFFD; return 1; }
 
-cursesxx::Widget::Widget( const Widget& parent, const Anchor& a ) :
-    geometry( parent.geometry ),
-    anchor( parent.anchor, a ),
-    window( newwin( 
-                this->geometry.height(),
-                this->geometry.width(),
-                this->anchor.y,
-                this->anchor.x ) )
-{}
+    if( n > len - pos ) { c = 0xFFFD; return 1; }
 
-cursesxx::Widget::Widget( const Widget& parent, const BorderStyle& b ) :
-    geometry( parent.geometry ),
-    window( newwin(
-                this->geometry.height() + 2,
-                this->geometry.width() + 2,
-                this->anchor.y - 1,
-                this->anchor.x - 1 ) ),
-    decoration( this->window.get(), b )
-{}
+    for( std::size_t i = 1; i < n; ++i ) {
+        if( ( s[ i ] & 0xC0 ) != 0x80 ) { c = 0xFFFD; return 1; }
+        c = ( c << 6 ) | ( s[ i ] & 0x3F );
+    }
 
-cursesxx::Widget::Widget( const Widget& parent,
-        const Geometry& g,
-        const Anchor& a ) :
-    geometry( g ),
-    anchor( parent.anchor, a ),
-    window( newwin(
-                this->geometry.height(),
-                this->geometry.width(),
-                this->anchor.y,
-                this->anchor.x ) )
+    return n;
+}
+
+/*
+ * Columns a character takes up on screen. wcwidth() goes through the
+ * locale on every call, so the Basic Multilingual Plane is looked up a page
+ * of 256 characters at a time, on first use, and kept. Characters wcwidth()
+ * knows nothing about count as one column.
+ */
+static int glyph_width( wchar_t c ) {
+    if( c < 0x80 ) return 1;
+
+    if( c > 0xFFFF ) {
+        const int width = wcwidth( c );
+        return width < 0 ? 1 : width;
+    }
+
+    static std::unique_ptr< signed char[] > pages[ 256 ];
+    std::unique_ptr< signed char[] >& page = pages[ c >> 8 ];
+
+    if( !page ) {
+        page.reset( new signed char[ 256 ] );
+        for( int i = 0; i < 256; ++i ) {
+            const int width = wcwidth( ( c & ~0xFF ) | i );
+            page[ i ] = width < 0 ? 1 : width;
+        }
+    }
+
+    return page[ c & 0xFF ];
+}
+
+/* Columns text[0, len) takes up on screen */
+static std::size_t columns( const char* text, std::size_t len ) {
+    if( ascii( text, len ) ) return len;
+
+    std::size_t width = 0;
+    for( std::size_t pos = 0; pos < len; ) {
+        wchar_t c;
+        pos += decode( text, len, pos, c );
+        width += glyph_width( c );
+    }
+
+    return width;
+}
+
+/*
+ * The bytes of the longest prefix of text[0, len) that fits in cols
+ * columns, never ending inside a character. cols is set to the columns the
+ * prefix takes up.
+ */
+static std::size_t fit( const char* text, std::size_t len, std::size_t& cols ) {
+    if( ascii( text, len ) ) {
+        cols = std::min( cols, len );
+        return cols;
+    }
+
+    std::size_t pos = 0, width = 0;
+    while( pos < len ) {
+        wchar_t c;
+        const std::size_t n = decode( text, len, pos, c );
+        const int w = glyph_width( c );
+        if( width + w > cols ) break;
+
+        width += w;
+        pos += n;
+    }
+
+    cols = width;
+    return pos;
+}
+
+/*
+ * Calls f( pos ) for every newline in text[0, len), in order, and returns
+ * whether the text is all ASCII, which costs next to nothing on the way.
+ * Uses the widest vector unit the target was compiled for and falls back to
+ * memchr, which is vectorised in every libc that matters.
+ */
+template< typename F >
+static bool find_newlines( const char* text, std::size_t len, F f ) {
+    std::size_t pos = 0;
+    unsigned int high = 0;
+
+#if defined( __AVX2__ )
+    const __m256i nl32 = _mm256_set1_epi8( '\n' );
+    for( ; pos + 32 <= len; pos += 32 ) {
+        const __m256i chunk = _mm256_loadu_si256(
+                reinterpret_cast< const __m256i* >( text + pos ) );
+        high |= _mm256_movemask_epi8( chunk );
+        unsigned int mask = _mm256_movemask_epi8(
+                _mm256_cmpeq_epi8( chunk, nl32 ) );
+
+        while( mask ) {
+            f( pos + __builtin_ctz( mask ) );
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+#if defined( __SSE2__ )
+    const __m128i nl16 = _mm_set1_epi8( '\n' );
+    for( ; pos + 16 <= len; pos += 16 ) {
+        const __m128i chunk = _mm_loadu_si128(
+                reinterpret_cast< const __m128i* >( text + pos ) );
+        high |= _mm_movemask_epi8( chunk );
+        unsigned int mask = _mm_movemask_epi8( _mm_cmpeq_epi8( chunk, nl16 ) );
+
+        while( mask ) {
+            f( pos + __builtin_ctz( mask ) );
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    const bool narrow = high == 0 && ascii( text + pos, len - pos );
+
+    while( pos < len ) {
+        const void* hit = std::memchr( text + pos, '\n', len - pos );
+        if( !hit ) break;
+
+        const std::size_t nl = static_cast< const char* >( hit ) - text;
+        f( nl );
+        pos = nl + 1;
+    }
+
+    return narrow;
+}
+
+cursesxx::Text::Text( const char* str ) :
+    data_( str ),
+    size_( std::strlen( str ) )
 {}
 
-cursesxx::Widget::Widget( const Widget& parent,
-        const Anchor& a, const BorderStyle& b ) :
-    geometry( parent.geometry ),
-    anchor( parent.anchor, a ),
-    window( newwin( 
-                this->geometry.height() + 2,
-                this->geometry.width() + 2,
-                this->anchor.y - 1,
-                this->anchor.x - 1 ) ),
-    decoration( this->window.get(), b )
+cursesxx::Text::Text( const char* str, std::size_t len ) :
+    data_( str ),
+    size_( len )
 {}
 
-cursesxx::Widget::Widget( const Widget& parent, const Geometry& g,
-        const Anchor& a, const BorderStyle& b ) :
-    geometry( g ),
-    anchor( parent.anchor, a ),
-    window( newwin( 
-                this->geometry.height() + 2,
-                this->geometry.width() + 2,
-                this->anchor.y - 1,
-                this->anchor.x - 1 ) ),
-    decoration( this->window.get(), b )
+cursesxx::Text::Text( const std::string& str ) :
+    data_( str.data() ),
+    size_( str.size() )
 {}
 
-cursesxx::Widget::~Widget() {
+const char* cursesxx::Text::data() const {
+    return this->data_;
 }
 
-int cursesxx::Widget::height() const {
-    return this->geometry.height();
+std::size_t cursesxx::Text::size() const {
+    return this->size_;
 }
 
-int cursesxx::Widget::width() const {
-    return this->geometry.width();
+std::size_t cursesxx::Text::width() const {
+    return columns( this->data_, this->size_ );
 }
 
-void cursesxx::Widget::redraw() {
-    wrefresh( this->window.get() );
+bool cursesxx::Text::empty() const {
+    return this->size_ == 0;
 }
 
-void cursesxx::Widget::clear() {
-    wclear( this->window.get() );
+cursesxx::LineIndex::LineIndex() :
+    starts( 1, 0 ),
+    longest_( 0 ),
+    size_( 0 ),
+    last_width( 0 )
+{}
+
+cursesxx::LineIndex::LineIndex( const std::string& text ) :
+    LineIndex( text.data(), text.size() )
+{}
+
+cursesxx::LineIndex::LineIndex( const char* text, std::size_t len ) :
+    LineIndex()
+{
+    this->extend( text, len );
 }
 
-void cursesxx::Widget::mvhorizontal( int pos ) {
-    this->x = std::max( std::min( this->geometry.width(), x + pos ), 0 );
+void cursesxx::LineIndex::assign( const char* text, std::size_t len ) {
+    this->starts.assign( 1, 0 );
+    this->longest_ = 0;
+    this->size_ = 0;
+    this->last_width = 0;
+    this->extend( text, len );
 }
 
-void cursesxx::Widget::mvvertical( int pos ) {
-    this->y = std::max( std::min( this->geometry.height(), y + pos ), 0 );
+/*
+ * Indexes text as if appended to the text already indexed. Only the new
+ * text is scanned; the last line may continue from before. Lines of ASCII
+ * text are as wide as they are long, so only other text is measured.
+ */
+void cursesxx::LineIndex::extend( const char* text, std::size_t len ) {
+    const std::size_t base = this->size_;
+    const std::size_t first = this->starts.size();
+    std::size_t longest = this->longest_;
+    std::size_t width = this->last_width;
+    std::size_t from = 0;
+
+    const bool narrow = find_newlines( text, len, [&]( std::size_t nl ) {
+        longest = std::max( longest, width + nl - from );
+        width = 0;
+        from = nl + 1;
+        this->starts.push_back( base + from );
+    } );
+
+    if( !narrow ) {
+        /* measured again, this time in columns */
+        longest = this->longest_;
+        width = this->last_width;
+        from = 0;
+
+        for( std::size_t line = first; line < this->starts.size(); ++line ) {
+            const std::size_t nl = this->starts[ line ] - base - 1;
+            longest = std::max( longest, width + columns( text + from, nl - from ) );
+            width = 0;
+            from = nl + 1;
+        }
+
+        width += columns( text + from, len - from );
+    } else {
+        width += len - from;
+    }
+
+    this->size_ = base + len;
+    this->last_width = width;
+    this->longest_ = std::max( longest, width );
 }
 
-void cursesxx::Widget::move( int y, int x ) {
-    this->mvvertical( y );
-    this->mvhorizontal( x );
+std::size_t cursesxx::LineIndex::lines() const {
+    return this->starts.size();
 }
 
-void cursesxx::Widget::write( const std::string& str ) {
-    const Anchor& a = this->anchor;
-    wmove( this->window.get(), a.y + y, a.x + x );
-    waddstr( this->window.get(), str.c_str() );
+std::size_t cursesxx::LineIndex::longest() const {
+    return this->longest_;
 }
 
-void cursesxx::Widget::write( const std::string& str, const int maxlen ) {
-    const Anchor& a = this->anchor;
-    wmove( this->window.get(), a.y + y, a.x + x );
-    waddnstr( this->window.get(), str.c_str(), maxlen );
+std::size_t cursesxx::LineIndex::size() const {
+    return this->size_;
 }
 
-void cursesxx::Widget::decorate( const cursesxx::BorderStyle& b ) {
-    this->decoration.set( b );
+std::size_t cursesxx::LineIndex::begin( std::size_t line ) const {
+    return this->starts[ line ];
 }
 
-void cursesxx::Widget::put( char c ) {
-    wechochar( this->window.get(), c );
+std::size_t cursesxx::LineIndex::length( std::size_t line ) const {
+    const std::size_t end = line + 1 < this->starts.size()
+        ? this->starts[ line + 1 ] - 1
+        : this->size_;
+
+    return end - this->starts[ line ];
 }
 
-void cursesxx::Widget::put( char c, int y, int x ) {
-    const Anchor& a = this->anchor;
-    mvwaddch( this->window.get(), a.y + y, a.x + x, c );
+std::vector< cursesxx::LineIndex::Row > cursesxx::LineIndex::wrap(
+        const char* text, int width ) const {
+
+    std::vector< Row > rows;
+    rows.reserve( this->starts.size() );
+
+    for( std::size_t line = 0; line < this->starts.size(); ++line )
+        this->wrap( text + this->starts[ line ], width, line, rows );
+
+    return rows;
+}
+
+static bool blank( char c ) {
+    return c == ' ' || c == '\t';
 }
 
 /*
- * TEXTFIELD
+ * LineIndex::wrap for a line that is not all ASCII, walking it a character
+ * at a time: the same breaks, but counted in columns, and never inside a
+ * character.
  */
+static void wrap_wide( const char* text, std::size_t end, std::size_t cols,
+        std::size_t base, std::vector< cursesxx::LineIndex::Row >& rows ) {
 
-void cursesxx::Textfield::write() {
-    this->widget.clear();
-    this->widget.move( 0, 0 );
-    this->widget.write( this->text );
+    std::size_t pos = 0;
+
+    while( pos < end ) {
+        /* as much as fits, and the last blank within it */
+        std::size_t cut = pos, brk = pos, used = 0;
+        while( cut < end ) {
+            wchar_t c;
+            const std::size_t n = decode( text, end, cut, c );
+            const std::size_t w = glyph_width( c );
+            if( used + w > cols ) break;
+
+            if( blank( text[ cut ] ) ) brk = cut;
+            used += w;
+            cut += n;
+        }
+
+        if( cut == end ) break;
+        if( blank( text[ cut ] ) ) brk = cut;
+
+        if( brk == pos ) {
+            /* a character wider than the row gets one of its own */
+            if( cut == pos ) {
+                wchar_t c;
+                cut += decode( text, end, cut, c );
+            }
+
+            rows.push_back( cursesxx::LineIndex::Row{ base + pos, cut - pos } );
+            pos = cut;
+        } else {
+            rows.push_back( cursesxx::LineIndex::Row{ base + pos, brk - pos } );
+            pos = brk + 1;
+        }
+    }
+
+    rows.push_back( cursesxx::LineIndex::Row{ base + pos, end - pos } );
 }
 
-void cursesxx::Textfield::write( const std::string& str ) {
-    this->text = str;
-    this->write();
+void cursesxx::LineIndex::wrap( const char* text, int width,
+        std::size_t line, std::vector< Row >& rows ) const {
+
+    const std::size_t cols = std::max( width, 1 );
+    const std::size_t base = this->begin( line );
+    const std::size_t end = this->length( line );
+    std::size_t pos = 0;
+
+    if( !ascii( text, end ) ) {
+        wrap_wide( text, end, cols, base, rows );
+        return;
+    }
+
+    while( end - pos > cols ) {
+        /* break after the last blank that still fits, if any */
+        std::size_t brk = pos + cols;
+        while( brk > pos && text[ brk ] != ' ' && text[ brk ] != '\t' )
+            --brk;
+
+        if( brk == pos ) {
+            rows.push_back( Row{ base + pos, cols } );
+            pos += cols;
+        } else {
+            rows.push_back( Row{ base + pos, brk - pos } );
+            pos = brk + 1;
+        }
+    }
+
+    rows.push_back( Row{ base + pos, end - pos } );
 }
 
-void cursesxx::Textfield::append( const std::string& str ) {
-    this->text.append( str );
+const std::size_t cursesxx::TextBuffer::chunk_size;
+
+cursesxx::TextBuffer::TextBuffer() :
+    chunks( 1, Chunk{ 0, std::string() } ),
+    size_( 0 ),
+    line_start( 0 )
+{}
+
+/* The string is taken over as the only chunk, however long it is */
+cursesxx::TextBuffer::TextBuffer( std::string text ) :
+    size_( text.size() ),
+    line_start( text.rfind( '\n' ) + 1 )
+{
+    this->chunks.push_back( Chunk{ 0, std::move( text ) } );
 }
 
-void cursesxx::Textfield::redraw() {
-    this->widget.redraw();
+void cursesxx::TextBuffer::assign( const char* text, std::size_t len ) {
+    this->chunks.resize( 1 );
+    this->chunks.front().text.clear();
+    this->size_ = 0;
+    this->line_start = 0;
+    this->append( text, len );
 }
 
-const cursesxx::Widget& cursesxx::Textfield::get_widget() const {
-    return this->widget;
+void cursesxx::TextBuffer::append( const char* text, std::size_t len ) {
+    Chunk* chunk = &this->chunks.back();
+    std::string& last = chunk->text;
+    const std::size_t limit = std::max( last.capacity(), chunk_size );
+
+    if( last.size() + len > limit ) {
+        /* the unfinished last line moves along so it stays contiguous */
+        const std::size_t tail = this->size_ - this->line_start;
+
+        if( tail == last.size() ) {
+            last.reserve( std::max( 2 * last.capacity(), last.size() + len ) );
+        } else {
+            Chunk next{ this->line_start, std::string() };
+            next.text.reserve( std::max( chunk_size, tail + len ) );
+            next.text.append( last, last.size() - tail, tail );
+            last.resize( last.size() - tail );
+
+            this->chunks.push_back( std::move( next ) );
+            chunk = &this->chunks.back();
+        }
+    }
+
+    chunk->text.append( text, len );
+
+    const char* end = text + len;
+    const auto nl = std::find( std::reverse_iterator< const char* >( end ),
+            std::reverse_iterator< const char* >( text ), '\n' );
+
+    if( nl.base() != text )
+        this->line_start = this->size_ + ( nl.base() - text );
+
+    this->size_ += len;
 }
 
-void cursesxx::Textfield::decorate( const cursesxx::BorderStyle& b ) {
-    this->widget.decorate( b );
+std::size_t cursesxx::TextBuffer::size() const {
+    return this->size_;
 }
 
-cursesxx::Geometry cursesxx::Textfield::text_wrap( const std::string& str ) {
-    const auto lines = std::count( str.begin(), str.end(), '\n' );
+bool cursesxx::TextBuffer::equals( const Text& str ) const {
+    if( str.size() != this->size_ ) return false;
+
+    for( const auto& chunk : this->chunks )
+        if( chunk.text.compare( 0, chunk.text.size(),
+                    str.data() + chunk.base, chunk.text.size() ) != 0 )
+            return false;
+
+    return true;
+}
+
+const char* cursesxx::TextBuffer::data( std::size_t pos ) const {
+    auto chunk = std::upper_bound( this->chunks.begin(), this->chunks.end(),
+            pos, []( std::size_t p, const Chunk& c ) { return p < c.base; } );
+
+    --chunk;
+    return chunk->text.data() + ( pos - chunk->base );
+}
+
+cursesxx::GapBuffer::GapBuffer() :
+    gap( 0 ),
+    gap_end( 0 )
+{}
+
+void cursesxx::GapBuffer::assign( const char* text, std::size_t len ) {
+    this->buffer.resize( std::max< std::size_t >( 2 * len, 64 ) );
+    std::memcpy( this->buffer.data(), text, len );
+    this->gap = len;
+    this->gap_end = this->buffer.size();
+}
+
+/* Grows the gap to at least n bytes, at least doubling the buffer */
+void cursesxx::GapBuffer::reserve( std::size_t n ) {
+    if( this->gap_end - this->gap >= n ) return;
+
+    const std::size_t after = this->buffer.size() - this->gap_end;
+    const std::size_t capacity = std::max( 2 * this->buffer.size(),
+            this->size() + n + 64 );
+
+    this->buffer.resize( capacity );
+    std::memmove( this->buffer.data() + capacity - after,
+            this->buffer.data() + this->gap_end, after );
+    this->gap_end = capacity - after;
+}
+
+void cursesxx::GapBuffer::insert( const char* text, std::size_t len ) {
+    this->reserve( len );
+    std::memcpy( this->buffer.data() + this->gap, text, len );
+    this->gap += len;
+}
+
+std::size_t cursesxx::GapBuffer::erase_before( std::size_t n ) {
+    n = std::min( n, this->gap );
+    this->gap -= n;
+    return n;
+}
 
-    size_t longest_line = 0;
-    size_t previous_pos = 0;
-    size_t current_pos = 0;
+std::size_t cursesxx::GapBuffer::erase_after( std::size_t n ) {
+    n = std::min( n, this->buffer.size() - this->gap_end );
+    this->gap_end += n;
+    return n;
+}
 
-    while( ( current_pos = str.find( '\n', current_pos ) ) ) {
-        longest_line = std::max( longest_line, current_pos - previous_pos );
-        previous_pos = current_pos;
+void cursesxx::GapBuffer::seek( std::size_t pos ) {
+    pos = std::min( pos, this->size() );
+    char* data = this->buffer.data();
 
-        if( current_pos == std::string::npos ) break;
+    if( pos < this->gap ) {
+        const std::size_t n = this->gap - pos;
+        std::memmove( data + this->gap_end - n, data + pos, n );
+        this->gap = pos;
+        this->gap_end -= n;
+    } else if( pos > this->gap ) {
+        const std::size_t n = pos - this->gap;
+        std::memmove( data + this->gap, data + this->gap_end, n );
+        this->gap += n;
+        this->gap_end += n;
     }
+}
 
-    const auto cols = std::min( longest_line , str.size() );
-    return cursesxx::Geometry( lines + 1, cols );
+std::size_t cursesxx::GapBuffer::cursor() const {
+    return this->gap;
 }
 
-cursesxx::Geometry cursesxx::Textfield::text_wrap(
-        const std::string& str, const int width ) {
+std::size_t cursesxx::GapBuffer::size() const {
+    return this->buffer.size() - ( this->gap_end - this->gap );
+}
+
+char cursesxx::GapBuffer::at( std::size_t pos ) const {
+    if( pos < this->gap ) return this->buffer[ pos ];
+    return this->buffer[ pos + this->gap_end - this->gap ];
+}
+
+void cursesxx::GapBuffer::copy( std::size_t pos, std::size_t len,
+        std::string& out ) const {
+
+    const char* data = this->buffer.data();
+
+    if( pos < this->gap ) {
+        const std::size_t n = std::min( len, this->gap - pos );
+        out.append( data + pos, n );
+        pos += n;
+        len -= n;
+    }
 
-    return cursesxx::Geometry( ( str.size() / width ) + 1, width );
+    if( len > 0 ) out.append( data + pos + this->gap_end - this->gap, len );
+}
+
+std::string cursesxx::GapBuffer::str() const {
+    std::string text;
+    text.reserve( this->size() );
+    this->copy( 0, this->size(), text );
+    return text;
 }
 
 /*
- * LABEL
+ * Node 0 is the root, which is nobody's child or sibling, so 0 doubles as
+ * the end of a child or sibling list.
  */
-cursesxx::Label::Label( const std::string& text ) :
-    widget( text )
+cursesxx::Trie::Trie() :
+    nodes( 1, Node{ 0, 0, 0, false } )
 {}
 
-void cursesxx::Label::redraw() {
-    this->widget.write();
-    this->widget.redraw();
+bool cursesxx::Trie::add( const Text& str ) {
+    std::uint32_t node = 0;
+
+    for( std::size_t i = 0; i < str.size(); ++i ) {
+        const unsigned char byte = str.data()[ i ];
+
+        std::uint32_t prev = 0;
+        std::uint32_t next = this->nodes[ node ].child;
+        while( next && this->nodes[ next ].byte < byte ) {
+            prev = next;
+            next = this->nodes[ next ].sibling;
+        }
+
+        if( next && this->nodes[ next ].byte == byte ) {
+            node = next;
+            continue;
+        }
+
+        const std::uint32_t fresh = this->nodes.size();
+        this->nodes.push_back( Node{ 0, next, byte, false } );
+        if( prev ) this->nodes[ prev ].sibling = fresh;
+        else       this->nodes[ node ].child = fresh;
+        node = fresh;
+    }
+
+    if( this->nodes[ node ].word ) return false;
+
+    this->nodes[ node ].word = true;
+    ++this->words;
+    return true;
 }
 
-const cursesxx::Widget& cursesxx::Label::get_widget() const {
-    return this->widget.get_widget();
+/* The node text[0, len) leads to, or -1 if no word starts with it */
+std::uint32_t cursesxx::Trie::find( const char* text, std::size_t len ) const {
+    const std::uint32_t missing = std::numeric_limits< std::uint32_t >::max();
+    std::uint32_t node = 0;
+
+    for( std::size_t i = 0; i < len; ++i ) {
+        const unsigned char byte = text[ i ];
+
+        node = this->nodes[ node ].child;
+        while( node && this->nodes[ node ].byte < byte )
+            node = this->nodes[ node ].sibling;
+
+        if( !node || this->nodes[ node ].byte != byte ) return missing;
+    }
+
+    return node;
 }
 
-cursesxx::Application::Screen::Screen() {
-    initscr();
+bool cursesxx::Trie::contains( const Text& str ) const {
+    const std::uint32_t node = this->find( str.data(), str.size() );
+    return node < this->nodes.size() && this->nodes[ node ].word;
 }
 
-cursesxx::Application::Screen::~Screen() {
-    endwin();
+std::size_t cursesxx::Trie::size() const {
+    return this->words;
 }
 
-cursesxx::Application& cursesxx::Application::keypad( const bool enable ) {
-    ::keypad( stdscr, enable );
-    return *this;
+void cursesxx::Trie::clear() {
+    this->nodes.assign( 1, Node{ 0, 0, 0, false } );
+    this->words = 0;
 }
 
-cursesxx::Application& cursesxx::Application::echo( const bool enable ) {
-    enable ? ::echo() : noecho();
-    return *this;
+void cursesxx::Trie::collect( std::uint32_t node, std::string& word,
+        std::size_t limit, std::vector< std::string >& out,
+        std::size_t& found ) const {
+
+    if( this->nodes[ node ].word && found < limit ) {
+        if( found < out.size() ) out[ found ].assign( word );
+        else out.push_back( word );
+        ++found;
+    }
+
+    for( std::uint32_t child = this->nodes[ node ].child;
+            child && found < limit; child = this->nodes[ child ].sibling ) {
+        word.push_back( this->nodes[ child ].byte );
+        this->collect( child, word, limit, out, found );
+        word.pop_back();
+    }
 }
 
-cursesxx::Application& cursesxx::Application::cursor( const bool enable ) {
-    curs_set( enable ? 1 : 0 );
-    return *this;
+std::size_t cursesxx::Trie::complete( const Text& prefix, std::size_t limit,
+        std::vector< std::string >& out ) const {
+
+    std::size_t found = 0;
+    const std::uint32_t node = this->find( prefix.data(), prefix.size() );
+
+    if( node < this->nodes.size() ) {
+        std::string word( prefix.data(), prefix.size() );
+        this->collect( node, word, limit, out, found );
+    }
+
+    out.resize( found );
+    return found;
+}
+
+/*
+ * Follows the trie down from the prefix for as long as there is exactly
+ * one way to go. Where the words part inside a character, the character
+ * is left out.
+ */
+std::string cursesxx::Trie::common( const Text& prefix ) const {
+    std::string extension;
+    std::uint32_t node = this->find( prefix.data(), prefix.size() );
+    if( node >= this->nodes.size() ) return extension;
+
+    for( ;; ) {
+        const std::uint32_t child = this->nodes[ node ].child;
+        if( this->nodes[ node ].word || !child ) break;
+        if( this->nodes[ child ].sibling ) break;
+
+        extension.push_back( this->nodes[ child ].byte );
+        node = child;
+    }
+
+    std::size_t lead = extension.size();
+    while( lead > 0 && continuation( extension[ lead - 1 ] ) ) --lead;
+    if( lead == 0 ) return extension;
+
+    const unsigned char c = extension[ lead - 1 ];
+    const std::size_t length = c < 0x80 ? 1
+        : ( c & 0xE0 ) == 0xC0 ? 2
+        : ( c & 0xF0 ) == 0xE0 ? 3
+        : 4;
+    if( extension.size() - ( lead - 1 ) < length )
+        extension.resize( lead - 1 );
+
+    return extension;
+}
+
+cursesxx::Damage::Damage() :
+    all( true ),
+    top( 0 ),
+    bottom( -1 )
+{}
+
+void cursesxx::Damage::mark() {
+    this->all = true;
+}
+
+void cursesxx::Damage::mark( int row ) {
+    this->mark( row, 0, std::numeric_limits< int >::max() );
+}
+
+void cursesxx::Damage::mark( int row, int first, int last ) {
+    if( row < 0 ) return;
+
+    if( row >= int( this->rows.size() ) )
+        this->rows.resize( row + 1, Span{ std::numeric_limits< int >::max(), -1 } );
+
+    Span& span = this->rows[ row ];
+    span.first = std::min( span.first, first );
+    span.last = std::max( span.last, last );
+
+    if( this->top > this->bottom ) {
+        this->top = this->bottom = row;
+    } else {
+        this->top = std::min( this->top, row );
+        this->bottom = std::max( this->bottom, row );
+    }
+}
+
+void cursesxx::Damage::mark_rows( int first, int last ) {
+    for( int row = std::max( first, 0 ); row <= last; ++row )
+        this->mark( row );
+}
+
+void cursesxx::Damage::reset() {
+    for( int row = this->top; row <= this->bottom; ++row )
+        this->rows[ row ] = Span{ std::numeric_limits< int >::max(), -1 };
+
+    this->all = false;
+    this->top = 0;
+    this->bottom = -1;
+}
+
+bool cursesxx::Damage::clean() const {
+    return !this->all && this->top > this->bottom;
+}
+
+bool cursesxx::Damage::dirty( int row ) const {
+    if( this->all ) return true;
+    if( row < this->top || row > this->bottom ) return false;
+
+    return this->rows[ row ].first <= this->rows[ row ].last;
+}
+
+int cursesxx::Damage::first( int row ) const {
+    if( this->all ) return 0;
+    return this->dirty( row ) ? this->rows[ row ].first : -1;
+}
+
+int cursesxx::Damage::last( int row ) const {
+    if( this->all ) return std::numeric_limits< int >::max();
+    return this->dirty( row ) ? this->rows[ row ].last : -1;
+}
+
+void cursesxx::Damage::apply( WINDOW* win ) const {
+    if( this->all ) return;
+
+    const int height = getmaxy( win );
+    int row = 0;
+
+    /* untouch every maximal run of clean rows with a single call */
+    while( row < height ) {
+        if( this->dirty( row ) ) { ++row; continue; }
+
+        const int start = row;
+        while( row < height && !this->dirty( row ) ) ++row;
+        wtouchln( win, start, row - start, 0 );
+    }
+}
+
+/*
+ * Creates the window of a child widget at screen position (y, x). A child is
+ * a view into its parent's window (derwin) that shares the parent's cells,
+ * so it costs no cell buffer of its own and curses has one window less to
+ * reconcile. A child that does not fit inside its parent gets a window of
+ * its own instead.
+ */
+static WINDOW* child_window( WINDOW* parent,
+        int height, int width, int y, int x ) {
+
+    int top, left;
+    getbegyx( parent, top, left );
+
+    WINDOW* win = derwin( parent, height, width, y - top, x - left );
+    return win ? win : newwin( height, width, y, x );
+}
+
+/* The content window of a bordered widget, just inside its frame */
+static WINDOW* content_window( WINDOW* frame, const cursesxx::Geometry& g ) {
+    return derwin( frame, g.height(), g.width(), 1, 1 );
+}
+
+cursesxx::Widget::Widget() :
+    window( newwin(
+                this->geometry.height(),
+                this->geometry.width(),
+                this->anchor.y,
+                this->anchor.x ) )
+{}
+
+cursesxx::Widget::Widget( const Geometry& g ) :
+    geometry( g ),
+    window( newwin(
+                g.height(),
+                g.width(),
+                this->anchor.y,
+                this->anchor.x ) )
+{}
+
+cursesxx::Widget::Widget( const Anchor& a ) :
+    anchor( a ),
+    window( newwin(
+                this->geometry.height(),
+                this->geometry.width(),
+                a.y,
+                a.x ) )
+{}
+
+cursesxx::Widget::Widget( const BorderStyle& b ) :
+    geometry( true ),
+    anchor( true ),
+    frame( newwin(
+                this->geometry.height() + 2,
+                this->geometry.width() + 2,
+                this->anchor.y - 1,
+                this->anchor.x - 1 ) ),
+    window( content_window( this->frame.get(), this->geometry ) ),
+    decoration( this->frame.get(), b )
+{}
+
+cursesxx::Widget::Widget( const Geometry& g, const Anchor& a ) :
+    geometry( g ),
+    anchor( a ),
+    window( newwin( 
+                g.height(),
+                g.width(),
+                a.y,
+                a.x ) )
+{}
+
+cursesxx::Widget::Widget( const Geometry& g, const BorderStyle& b ) :
+    geometry( g ),
+    anchor( true ),
+    frame( newwin(
+                g.height() + 2,
+                g.width() + 2,
+                this->anchor.y - 1,
+                this->anchor.x - 1 ) ),
+    window( content_window( this->frame.get(), g ) ),
+    decoration( this->frame.get(), b )
+{}
+
+cursesxx::Widget::Widget( const Anchor& a, const BorderStyle& b ) :
+    geometry( true ),
+    anchor( a ),
+    frame( newwin(
+                this->geometry.height() + 2,
+                this->geometry.width() + 2,
+                a.y - 1,
+                a.x - 1 ) ),
+    window( content_window( this->frame.get(), this->geometry ) ),
+    decoration( this->frame.get(), b )
+{}
+
+cursesxx::Widget::Widget( const Geometry& g,
+        const Anchor& a, const BorderStyle& b ) :
+    geometry( g ),
+    anchor( a ),
+    frame( newwin(
+                g.height() + 2,
+                g.width() + 2,
+                a.y - 1,
+                a.x - 1 ) ),
+    window( content_window( this->frame.get(), g ) ),
+    decoration( this->frame.get(), b )
+{}
+
+cursesxx::Widget::Widget( const Widget& parent ) :
+    geometry( parent.geometry, parent.geometry.height(),
+            parent.geometry.width(), true ),
+    anchor( parent.anchor ),
+    container( const_cast< Widget* >( &parent ) ),
+    frame( child_window( parent.window.get(),
+                parent.geometry.height(),
+                parent.geometry.width(),
+                this->anchor.y,
+                this->anchor.x ) ),
+    window( content_window( this->frame.get(), this->geometry ) ),
+    decoration( this->frame.get() )
+{}
+
+cursesxx::Widget::Widget( const Widget& parent, const Geometry& g ) :
+    geometry( g ),
+    anchor( parent.anchor ),
+    container( const_cast< Widget* >( &parent ) ),
+    window( child_window( parent.window.get(),
+                g.height(),
+                g.width(),
+                this->anchor.y,
+                this->anchor.x ) )
+{}
+
+cursesxx::Widget::Widget( const Widget& parent, const Anchor& a ) :
+    geometry( parent.geometry ),
+    anchor( parent.anchor, a ),
+    container( const_cast< Widget* >( &parent ) ),
+    window( child_window( parent.window.get(),
+                this->geometry.height(),
+                this->geometry.width(),
+                this->anchor.y,
+                this->anchor.x ) )
+{}
+
+cursesxx::Widget::Widget( const Widget& parent, const BorderStyle& b ) :
+    geometry( parent.geometry, parent.geometry.height(),
+            parent.geometry.width(), true ),
+    anchor( parent.anchor ),
+    container( const_cast< Widget* >( &parent ) ),
+    frame( child_window( parent.window.get(),
+                this->geometry.height() + 2,
+                this->geometry.width() + 2,
+                this->anchor.y,
+                this->anchor.x ) ),
+    window( content_window( this->frame.get(), this->geometry ) ),
+    decoration( this->frame.get(), b )
+{}
+
+cursesxx::Widget::Widget( const Widget& parent,
+        const Geometry& g,
+        const Anchor& a ) :
+    geometry( g ),
+    anchor( parent.anchor, a ),
+    container( const_cast< Widget* >( &parent ) ),
+    window( child_window( parent.window.get(),
+                this->geometry.height(),
+                this->geometry.width(),
+                this->anchor.y,
+                this->anchor.x ) )
+{}
+
+cursesxx::Widget::Widget( const Widget& parent,
+        const Anchor& a, const BorderStyle& b ) :
+    geometry( parent.geometry, parent.geometry.height() - a.y,
+            parent.geometry.width() - a.x, true ),
+    anchor( parent.anchor, a ),
+    container( const_cast< Widget* >( &parent ) ),
+    frame( child_window( parent.window.get(),
+                this->geometry.height() + 2,
+                this->geometry.width() + 2,
+                this->anchor.y,
+                this->anchor.x ) ),
+    window( content_window( this->frame.get(), this->geometry ) ),
+    decoration( this->frame.get(), b )
+{}
+
+cursesxx::Widget::Widget( const Widget& parent, const Geometry& g,
+        const Anchor& a, const BorderStyle& b ) :
+    geometry( g ),
+    anchor( parent.anchor, a ),
+    container( const_cast< Widget* >( &parent ) ),
+    frame( child_window( parent.window.get(),
+                this->geometry.height() + 2,
+                this->geometry.width() + 2,
+                this->anchor.y - 1,
+                this->anchor.x - 1 ) ),
+    window( content_window( this->frame.get(), this->geometry ) ),
+    decoration( this->frame.get(), b )
+{}
+
+cursesxx::Widget::~Widget() {
+}
+
+/*
+ * A view is blanked in the window it is part of. A window of its own has
+ * already left the panel stack, which shows whatever it covered.
+ */
+void cursesxx::Widget::Win::operator()( WINDOW* ptr ) {
+    if( wgetparent( ptr ) ) {
+        werase( ptr );
+        stage( ptr, nullptr );
+    }
+
+    delwin( ptr );
+}
+
+void cursesxx::Widget::Unstack::operator()( PANEL* ptr ) {
+    del_panel( ptr );
+    reorder();
+}
+
+/*
+ * The panel of a new widget, on top of the stack. Views are part of their
+ * parent's panel and get none.
+ */
+PANEL* cursesxx::Widget::stack( WINDOW* frame, WINDOW* window ) {
+    WINDOW* outer = frame ? frame : window;
+    if( wgetparent( outer ) ) return nullptr;
+
+    /* a new panel goes on top, so only what is below it can overlap */
+    PANEL* panel = new_panel( outer );
+    if( panel && !stack_changed && !stack_layered )
+        stack_layered = overlapped( panel, panel_below );
+
+    return panel;
+}
+
+const cursesxx::Widget& cursesxx::Widget::get_widget() const {
+    return *this;
+}
+
+/*
+ * Stacking order. Each change repaints only what it exposes or covers, and
+ * does nothing for views, which are stacked with their parent.
+ */
+void cursesxx::Widget::raise() {
+    if( !this->panel ) return;
+    top_panel( this->panel.get() );
+    reorder();
+}
+
+void cursesxx::Widget::lower() {
+    if( !this->panel ) return;
+    bottom_panel( this->panel.get() );
+    reorder();
+}
+
+void cursesxx::Widget::hide() {
+    if( !this->panel ) return;
+    hide_panel( this->panel.get() );
+    reorder();
+}
+
+void cursesxx::Widget::show() {
+    if( !this->panel ) return;
+    show_panel( this->panel.get() );
+    reorder();
+}
+
+bool cursesxx::Widget::hidden() const {
+    return this->panel && panel_hidden( this->panel.get() ) == TRUE;
+}
+
+/* The screen position of the widget's content */
+cursesxx::Anchor cursesxx::Widget::position() const {
+    int y, x;
+    getbegyx( this->window.get(), y, x );
+    return Anchor( y, x );
+}
+
+int cursesxx::Widget::height() const {
+    return this->geometry.height();
+}
+
+int cursesxx::Widget::width() const {
+    return this->geometry.width();
+}
+
+void cursesxx::Widget::redraw() {
+    Probe::Scope count( this->probe, Counters::redraw );
+
+    this->damage.apply( this->window.get() );
+
+    {
+        Probe::Scope count( this->probe, Counters::refresh );
+        stage( this->window.get(), this->panel.get() );
+    }
+
+    this->propagate( this->damage );
+    this->damage.reset();
+}
+
+/*
+ * A view's changes are synced up into the windows it is part of, touching
+ * their rows. The same rows are marked in the damage of the widgets those
+ * windows belong to, or one of them redrawn later in the frame would
+ * untouch them again and the changes would never reach the screen.
+ */
+void cursesxx::Widget::propagate( const Damage& changed ) const {
+    const int edge = std::numeric_limits< int >::max();
+    WINDOW* win = this->window.get();
+
+    int top, left;
+    getbegyx( win, top, left );
+    const int height = getmaxy( win );
+    const int width = getmaxx( win );
+
+    const Widget* view = this;
+    for( Widget* up = this->container; up; up = up->container ) {
+        WINDOW* outer = view->frame ? view->frame.get() : view->window.get();
+        if( !wgetparent( outer ) ) return;
+
+        int y, x;
+        getbegyx( up->window.get(), y, x );
+
+        for( int row = 0; row < height; ++row ) {
+            if( !changed.dirty( row ) ) continue;
+
+            const int last = changed.last( row );
+            up->damage.mark( row + top - y,
+                    std::max( changed.first( row ), 0 ) + left - x,
+                    last >= width ? edge : last + left - x );
+        }
+
+        view = up;
+    }
+}
+
+void cursesxx::Widget::clear() {
+    Probe::Scope count( this->probe, Counters::clear );
+    werase( this->window.get() );
+    this->damage.mark();
+}
+
+void cursesxx::Widget::clear_line( int y, int x ) {
+    Probe::Scope count( this->probe, Counters::clear );
+    if( wmove( this->window.get(), y, x ) == ERR ) return;
+    wclrtoeol( this->window.get() );
+    this->damage.mark( y, x, std::numeric_limits< int >::max() );
+}
+
+void cursesxx::Widget::clear_below( int y ) {
+    Probe::Scope count( this->probe, Counters::clear );
+    WINDOW* win = this->window.get();
+    if( wmove( win, y, 0 ) == ERR ) return;
+    wclrtobot( win );
+    this->damage.mark_rows( y, getmaxy( win ) - 1 );
+}
+
+/*
+ * Marks everything between (y, x) and the current cursor position as dirty.
+ * Writes that stay on one row only dirty the written span.
+ */
+void cursesxx::Widget::touched( int y, int x ) {
+    int cy, cx;
+    getyx( this->window.get(), cy, cx );
+
+    if( cy == y )
+        this->damage.mark( y, x, std::max( x, cx - 1 ) );
+    else
+        this->damage.mark_rows( std::min( y, cy ), std::max( y, cy ) );
+}
+
+void cursesxx::Widget::mvhorizontal( int pos ) {
+    this->x = std::max( std::min( this->geometry.width(), x + pos ), 0 );
+}
+
+void cursesxx::Widget::mvvertical( int pos ) {
+    this->y = std::max( std::min( this->geometry.height(), y + pos ), 0 );
+}
+
+void cursesxx::Widget::move( int y, int x ) {
+    this->mvvertical( y );
+    this->mvhorizontal( x );
+}
+
+/*
+ * Writes text at the cursor. ASCII goes through the narrow call, as it
+ * always has; anything else is decoded into a reused wide buffer first.
+ */
+static void add_text( WINDOW* win, const char* text, std::size_t len ) {
+    if( ascii( text, len ) ) {
+        waddnstr( win, text, len );
+        return;
+    }
+
+    static std::vector< wchar_t > wide;
+    wide.clear();
+
+    for( std::size_t pos = 0; pos < len; ) {
+        wchar_t c;
+        pos += decode( text, len, pos, c );
+        wide.push_back( c );
+    }
+
+    waddnwstr( win, wide.data(), wide.size() );
+}
+
+void cursesxx::Widget::write( const Text& str ) {
+    Probe::Scope count( this->probe, Counters::write );
+    wmove( this->window.get(), y, x );
+    add_text( this->window.get(), str.data(), str.size() );
+    this->touched( y, x );
+    this->probe.wrote( str.size() );
+}
+
+void cursesxx::Widget::write( const Text& str, const int maxlen ) {
+    Probe::Scope count( this->probe, Counters::write );
+    std::size_t len = std::min< std::size_t >( str.size(), maxlen );
+    while( len > 0 && len < str.size() && continuation( str.data()[ len ] ) )
+        --len;
+
+    wmove( this->window.get(), y, x );
+    add_text( this->window.get(), str.data(), len );
+    this->touched( y, x );
+    this->probe.wrote( len );
+}
+
+void cursesxx::Widget::write( const char* str, int len, int y, int x ) {
+    Probe::Scope count( this->probe, Counters::write );
+    if( wmove( this->window.get(), y, x ) == ERR ) return;
+    add_text( this->window.get(), str, len );
+    this->touched( y, x );
+    this->probe.wrote( len );
+}
+
+/*
+ * Scrolls the widget's content n rows up, or down for negative n. The rows
+ * scrolled in are blank.
+ */
+void cursesxx::Widget::scroll_up( int n ) {
+    WINDOW* win = this->window.get();
+    const int bottom = this->geometry.height() - 1;
+
+    scrollok( win, TRUE );
+    wsetscrreg( win, 0, bottom );
+    wscrl( win, n );
+    scrollok( win, FALSE );
+
+    this->damage.mark_rows( 0, bottom );
+}
+
+void cursesxx::Widget::decorate( const cursesxx::BorderStyle& b ) {
+    this->decoration.set( b );
+}
+
+/*
+ * Moves and resizes a window. A window of its own is resized and moved in
+ * place along with its panel; a view into another window cannot move on its
+ * own, so it is replaced by a new view into the same parent.
+ */
+void cursesxx::Widget::relocate( std::unique_ptr< WINDOW, Win >& win,
+        PANEL* panel, int y, int x, int height, int width ) {
+
+    WINDOW* parent = wgetparent( win.get() );
+
+    if( parent ) {
+        win.reset( child_window( parent, height, width, y, x ) );
+        return;
+    }
+
+    int top, left, h, w;
+    getbegyx( win.get(), top, left );
+    getmaxyx( win.get(), h, w );
+
+    /* the area it covered is shown again wherever it ends up */
+    if( h != height || w != width ) {
+        if( panel ) replace_panel( panel, win.get() );
+        wresize( win.get(), height, width );
+    }
+
+    if( top == y && left == x ) return;
+    if( panel ) move_panel( panel, y, x );
+    else mvwin( win.get(), y, x );
+}
+
+void cursesxx::Widget::place( int y, int x, int height, int width ) {
+    const int border = this->frame ? 1 : 0;
+    const int inner_height = std::max( height - 2 * border, 1 );
+    const int inner_width = std::max( width - 2 * border, 1 );
+
+    /*
+     * A panel exposes whatever its old position covered when it moves. A
+     * view blanks its old position in the window it is part of.
+     */
+    WINDOW* outer = this->frame ? this->frame.get() : this->window.get();
+    werase( outer );
+    if( !this->panel ) {
+        stage( outer, nullptr );
+        this->propagate( Damage() );
+    }
+
+    this->geometry.set_height( inner_height );
+    this->geometry.set_width( inner_width );
+    this->anchor = Anchor( y + border, x + border );
+
+    if( this->frame ) {
+        /* the content is a view into the frame, so it is made anew */
+        this->window.reset();
+        relocate( this->frame, this->panel.get(), y, x,
+                inner_height + 2, inner_width + 2 );
+        this->window.reset( content_window( this->frame.get(),
+                    this->geometry ) );
+
+        this->decoration.draw( this->frame.get() );
+    } else {
+        relocate( this->window, this->panel.get(),
+                y, x, inner_height, inner_width );
+    }
+
+    /* a view that no longer fits its parent got a window of its own */
+    if( !this->panel ) {
+        this->panel.reset( stack( this->frame.get(), this->window.get() ) );
+        if( this->panel ) this->container = nullptr;
+    } else {
+        reorder();
+    }
+
+    this->x = std::min( this->x, inner_width );
+    this->y = std::min( this->y, inner_height );
+    this->damage.mark();
+}
+
+void cursesxx::Widget::put( char c ) {
+    Probe::Scope count( this->probe, Counters::write );
+    this->probe.wrote( 1 );
+
+    int y, x;
+    getyx( this->window.get(), y, x );
+    waddch( this->window.get(), c );
+    this->touched( y, x );
+    stage( this->window.get(), this->panel.get() );
+    this->propagate( this->damage );
+}
+
+void cursesxx::Widget::put( char c, int y, int x ) {
+    Probe::Scope count( this->probe, Counters::write );
+    this->probe.wrote( 1 );
+
+    mvwaddch( this->window.get(), y, x, c );
+    this->damage.mark( y, x, x );
+}
+
+/*
+ * TEXTFIELD
+ */
+
+void cursesxx::Textfield::reflow() {
+    const int width = this->widget.width();
+    const std::size_t lines = this->index.lines();
+
+    this->rows.clear();
+    for( std::size_t line = 0; line < lines; ++line ) {
+        if( line + 1 == lines ) this->tail = this->rows.size();
+
+        const char* start = this->text.data( this->index.begin( line ) );
+        this->index.wrap( start, width, line, this->rows );
+    }
+}
+
+void cursesxx::Textfield::write() {
+    const std::size_t height = std::max( this->widget.height(), 0 );
+    const std::size_t end = std::min( this->rows.size(), this->top + height );
+
+    int row = 0;
+    for( std::size_t r = this->top; r < end; ++r, ++row ) {
+        const LineIndex::Row& span = this->rows[ r ];
+        const char* start = this->text.data( span.offset );
+        this->widget.write( start, span.length, row, 0 );
+        this->widget.clear_line( row, columns( start, span.length ) );
+    }
+
+    this->widget.clear_below( row );
+}
+
+/*
+ * Only rows whose content differs from what is on screen are rewritten, and
+ * within a row only the span between the first and last changed column.
+ * The new text is shown from its first row.
+ */
+void cursesxx::Textfield::write( const Text& str ) {
+    if( this->text.equals( str ) ) return;
+
+    LineIndex& index = this->fresh_index;
+    index.assign( str.data(), str.size() );
+
+    const auto& old_rows = this->rows;
+    auto& new_rows = this->fresh_rows;
+    new_rows.clear();
+    for( std::size_t line = 0; line < index.lines(); ++line )
+        index.wrap( str.data() + index.begin( line ), this->widget.width(),
+                line, new_rows );
+
+    const int height = std::max( this->widget.height(), 0 );
+    const int old_shown = std::min< std::size_t >( height,
+            old_rows.size() - std::min( this->top, old_rows.size() ) );
+    const int shown = std::min< std::size_t >( height, new_rows.size() );
+
+    for( int row = 0; row < shown; ++row ) {
+        const char* fresh = str.data() + new_rows[ row ].offset;
+        const int len = new_rows[ row ].length;
+
+        if( row >= old_shown ) {
+            this->widget.write( fresh, len, row, 0 );
+            this->widget.clear_line( row, columns( fresh, len ) );
+            continue;
+        }
+
+        const LineIndex::Row& old_row = old_rows[ this->top + row ];
+        const char* stale = this->text.data( old_row.offset );
+        const int old_len = old_row.length;
+
+        int first = 0;
+        while( first < len && first < old_len
+                && fresh[ first ] == stale[ first ] )
+            ++first;
+
+        if( first == len && len == old_len ) continue;
+
+        /*
+         * Columns are bytes in ASCII rows. Otherwise the rewrite starts at
+         * a character and runs to the end of the row, since the unchanged
+         * tail may have moved.
+         */
+        const bool narrow = ascii( fresh, len ) && ascii( stale, old_len );
+
+        int last = len;
+        if( narrow && len == old_len )
+            while( last > first && fresh[ last - 1 ] == stale[ last - 1 ] )
+                --last;
+
+        while( !narrow && first > 0 && first < len
+                && continuation( fresh[ first ] ) )
+            --first;
+
+        const int at = narrow ? first : columns( fresh, first );
+        const int width = narrow ? len : columns( fresh, len );
+        const int old_width = narrow ? old_len : columns( stale, old_len );
+
+        this->widget.write( fresh + first, last - first, row, at );
+        if( width < old_width ) this->widget.clear_line( row, width );
+    }
+
+    if( old_shown > shown )
+        this->widget.clear_below( shown );
+
+    /* rows of the last line start at the first row at or past its offset */
+    const std::size_t last_line = index.begin( index.lines() - 1 );
+    this->tail = std::partition_point( new_rows.begin(), new_rows.end(),
+            [=]( const LineIndex::Row& r ) { return r.offset < last_line; } )
+        - new_rows.begin();
+
+    /* swapped rather than copied, so the old memory is reused next time */
+    this->text.assign( str.data(), str.size() );
+    std::swap( this->index, this->fresh_index );
+    this->rows.swap( this->fresh_rows );
+    this->top = 0;
+}
+
+/*
+ * Appending only re-wraps the last line, which the new text continues, and
+ * renders the rows from there on. When the text runs past the bottom of the
+ * widget the window is scrolled rather than redrawn.
+ */
+void cursesxx::Textfield::append( const Text& str ) {
+    if( str.empty() ) return;
+
+    const std::size_t from = this->tail;
+    const LineIndex::Row before = this->rows[ from ];
+    const std::size_t first_line = this->index.lines() - 1;
+
+    this->text.append( str.data(), str.size() );
+    this->index.extend( str.data(), str.size() );
+
+    const int width = this->widget.width();
+    const std::size_t lines = this->index.lines();
+
+    this->rows.resize( from );
+    for( std::size_t line = first_line; line < lines; ++line ) {
+        if( line + 1 == lines ) this->tail = this->rows.size();
+
+        const char* start = this->text.data( this->index.begin( line ) );
+        this->index.wrap( start, width, line, this->rows );
+    }
+
+    const std::size_t height = std::max( this->widget.height(), 1 );
+    if( this->rows.size() > this->top + height ) {
+        const std::size_t overflow = this->rows.size() - this->top - height;
+        this->top += overflow;
+
+        /* scrolled past everything that is on screen; draw it afresh */
+        if( overflow >= height ) return this->write();
+
+        this->widget.scroll_up( overflow );
+    }
+
+    int row = std::max( from, this->top ) - this->top;
+    for( std::size_t r = this->top + row; r < this->rows.size(); ++r, ++row ) {
+        const LineIndex::Row& span = this->rows[ r ];
+
+        /* the row the cursor was on keeps what it had, if it only grew */
+        int skip = 0;
+        if( r == from && span.offset == before.offset
+                && span.length >= before.length )
+            skip = before.length;
+
+        const char* start = this->text.data( span.offset );
+        const bool narrow = ascii( start, span.length );
+
+        this->widget.write( start + skip, span.length - skip, row,
+                narrow ? skip : columns( start, skip ) );
+        this->widget.clear_line( row,
+                narrow ? span.length : columns( start, span.length ) );
+    }
+}
+
+void cursesxx::Textfield::redraw() {
+    this->widget.redraw();
+}
+
+void cursesxx::Textfield::raise() {
+    this->widget.raise();
+}
+
+void cursesxx::Textfield::lower() {
+    this->widget.lower();
+}
+
+void cursesxx::Textfield::hide() {
+    this->widget.hide();
+}
+
+void cursesxx::Textfield::show() {
+    this->widget.show();
+}
+
+const cursesxx::Widget& cursesxx::Textfield::get_widget() const {
+    return this->widget;
+}
+
+void cursesxx::Textfield::decorate( const cursesxx::BorderStyle& b ) {
+    this->widget.decorate( b );
+}
+
+/*
+ * The text is wrapped again from the line index, and only if the width
+ * changed, and shown from the top.
+ */
+void cursesxx::Textfield::place( int y, int x, int height, int width ) {
+    const int before = this->widget.width();
+    this->widget.place( y, x, height, width );
+
+    if( this->widget.width() != before ) this->reflow();
+    this->top = 0;
+    this->write();
+}
+
+cursesxx::Geometry cursesxx::Textfield::text_wrap( const std::string& str ) {
+    const LineIndex index( str );
+    return cursesxx::Geometry( index.lines(), index.longest() );
+}
+
+cursesxx::Geometry cursesxx::Textfield::text_wrap(
+        const std::string& str, const int width ) {
+
+    const LineIndex index( str );
+    return cursesxx::Geometry( index.wrap( str.data(), width ).size(), width );
+}
+
+/*
+ * STATISTICS
+ */
+
+cursesxx::Counters::Counters() :
+    calls(),
+    nanoseconds(),
+    chars( 0 )
+{}
+
+cursesxx::Counters& cursesxx::Counters::operator+=( const Counters& other ) {
+    for( int e = 0; e < events; ++e ) {
+        this->calls[ e ] += other.calls[ e ];
+        this->nanoseconds[ e ] += other.nanoseconds[ e ];
+    }
+
+    this->chars += other.chars;
+    return *this;
+}
+
+cursesxx::Counters cursesxx::Counters::operator-(
+        const Counters& other ) const {
+
+    Counters diff( *this );
+    for( int e = 0; e < events; ++e ) {
+        diff.calls[ e ] -= other.calls[ e ];
+        diff.nanoseconds[ e ] -= other.nanoseconds[ e ];
+    }
+
+    diff.chars -= other.chars;
+    return diff;
+}
+
+const char* cursesxx::Counters::name( Event e ) {
+    static const char* const names[] = { "redraw", "refresh", "write", "clear" };
+    return names[ e ];
+}
+
+#ifdef CURSESXX_STATS
+cursesxx::Probe::Probe( const Widget* owner ) :
+    owner( owner ),
+    slot( probes.size() )
+{
+    probes.push_back( this );
+}
+
+cursesxx::Probe::~Probe() {
+    probes.back()->slot = this->slot;
+    probes[ this->slot ] = probes.back();
+    probes.pop_back();
+}
+
+void cursesxx::Probe::wrote( std::size_t chars ) {
+    this->counters_.chars += chars;
+    totals.chars += chars;
+}
+
+const cursesxx::Counters& cursesxx::Probe::counters() const {
+    return this->counters_;
+}
+
+const cursesxx::Widget& cursesxx::Probe::widget() const {
+    return *this->owner;
+}
+
+cursesxx::Probe::Scope::Scope( Probe& probe, Counters::Event event ) :
+    probe( probe ),
+    event( event ),
+    start( std::chrono::steady_clock::now() )
+{}
+
+cursesxx::Probe::Scope::~Scope() {
+    const auto ns = std::chrono::duration_cast< std::chrono::nanoseconds >(
+            std::chrono::steady_clock::now() - this->start ).count();
+
+    ++this->probe.counters_.calls[ this->event ];
+    this->probe.counters_.nanoseconds[ this->event ] += ns;
+    ++totals.calls[ this->event ];
+    totals.nanoseconds[ this->event ] += ns;
+}
+#endif
+
+static void counters_text( std::ostringstream& out,
+        const cursesxx::Counters& c ) {
+
+    for( int e = 0; e < cursesxx::Counters::events; ++e ) {
+        const auto event = cursesxx::Counters::Event( e );
+        out << ' ' << cursesxx::Counters::name( event ) << ' '
+            << c.calls[ e ] << " (" << c.nanoseconds[ e ] / 1000 << " us)";
+    }
+
+    out << " chars " << c.chars;
+}
+
+static void counters_json( std::ostringstream& out,
+        const cursesxx::Counters& c ) {
+
+    out << '{';
+    for( int e = 0; e < cursesxx::Counters::events; ++e ) {
+        const auto event = cursesxx::Counters::Event( e );
+        out << '"' << cursesxx::Counters::name( event ) << "\":{\"calls\":"
+            << c.calls[ e ] << ",\"ns\":" << c.nanoseconds[ e ] << "},";
+    }
+
+    out << "\"chars\":" << c.chars << '}';
+}
+
+std::string cursesxx::Statistics::text() const {
+    std::ostringstream out;
+
+    if( !this->enabled ) {
+        out << "statistics disabled (build with CURSESXX_STATS)\n";
+        return out.str();
+    }
+
+    out << "frames " << this->frames << "\ntotal:";
+    counters_text( out, this->total );
+    out << "\nlast frame:";
+    counters_text( out, this->last_frame );
+
+    out << "\nframe times:";
+    for( std::size_t i = 0; i < this->frame_times.size(); ++i )
+        if( this->frame_times[ i ] )
+            out << ' ' << ( 1ull << i ) << "us:" << this->frame_times[ i ];
+
+    out << '\n';
+    for( const Entry& w : this->widgets ) {
+        out << "widget (" << w.y << ',' << w.x << ") "
+            << w.height << 'x' << w.width << ':';
+        counters_text( out, w.counters );
+        out << '\n';
+    }
+
+    return out.str();
+}
+
+std::string cursesxx::Statistics::json() const {
+    std::ostringstream out;
+
+    out << "{\"enabled\":" << ( this->enabled ? "true" : "false" )
+        << ",\"frames\":" << this->frames << ",\"total\":";
+    counters_json( out, this->total );
+    out << ",\"last_frame\":";
+    counters_json( out, this->last_frame );
+
+    out << ",\"frame_times_us\":[";
+    for( std::size_t i = 0; i < this->frame_times.size(); ++i )
+        out << ( i ? "," : "" ) << this->frame_times[ i ];
+
+    out << "],\"widgets\":[";
+    for( std::size_t i = 0; i < this->widgets.size(); ++i ) {
+        const Entry& w = this->widgets[ i ];
+        out << ( i ? "," : "" ) << "{\"y\":" << w.y << ",\"x\":" << w.x
+            << ",\"height\":" << w.height << ",\"width\":" << w.width
+            << ",\"counters\":";
+        counters_json( out, w.counters );
+        out << '}';
+    }
+
+    out << "]}";
+    return out.str();
+}
+
+/*
+ * SCROLLBACK
+ */
+
+std::size_t cursesxx::Scrollback::rows() const {
+    return std::max( this->widget.height(), 1 );
+}
+
+std::size_t cursesxx::Scrollback::first() const {
+    return this->dropped;
+}
+
+std::size_t cursesxx::Scrollback::end() const {
+    return this->dropped + this->count;
+}
+
+void cursesxx::Scrollback::drop() {
+    std::string& oldest = this->ring[ this->head ];
+    this->bytes -= oldest.size();
+    oldest.clear();
+
+    this->head = ( this->head + 1 ) % this->ring.size();
+    --this->count;
+    ++this->dropped;
+}
+
+/*
+ * Reuses the slot of the line it replaces, so a full ring stops allocating
+ * once its strings have grown to the usual line length.
+ */
+void cursesxx::Scrollback::push_line( const char* text, std::size_t len ) {
+    if( this->count == this->ring.size() ) this->drop();
+
+    const std::size_t slot = ( this->head + this->count ) % this->ring.size();
+    this->ring[ slot ].assign( text, len );
+    this->bytes += len;
+    ++this->count;
+
+    while( this->max_bytes > 0 && this->bytes > this->max_bytes
+            && this->count > 1 )
+        this->drop();
+}
+
+void cursesxx::Scrollback::push( const Text& str ) {
+    const char* text = str.data();
+    std::size_t len = str.size();
+
+    while( len > 0 ) {
+        const void* nl = std::memchr( text, '\n', len );
+        const std::size_t n = nl
+            ? static_cast< const char* >( nl ) - text
+            : len;
+
+        this->push_line( text, n );
+        text += std::min( n + 1, len );
+        len -= std::min( n + 1, len );
+    }
+
+    if( this->follow ) this->bottom();
+    this->top = std::max( this->top, this->dropped );
+}
+
+void cursesxx::Scrollback::page_up() {
+    const std::size_t page = this->rows();
+    this->top = std::max( this->dropped,
+            this->top - std::min( this->top, page ) );
+    this->follow = false;
+}
+
+void cursesxx::Scrollback::page_down() {
+    this->jump( this->top + this->rows() );
+}
+
+void cursesxx::Scrollback::jump( std::size_t line ) {
+    const std::size_t page = this->rows();
+    const std::size_t last = std::max( this->dropped,
+            this->end() - std::min( this->end(), page ) );
+
+    this->top = std::min( std::max( line, this->dropped ), last );
+    this->follow = this->top == last;
+}
+
+void cursesxx::Scrollback::bottom() {
+    this->jump( this->end() );
+}
+
+void cursesxx::Scrollback::draw( std::size_t line ) {
+    const int row = line - this->top;
+
+    if( line >= this->end() ) {
+        this->widget.clear_line( row );
+        return;
+    }
+
+    const std::string& text =
+        this->ring[ ( this->head + line - this->dropped ) % this->ring.size() ];
+    std::size_t width = this->widget.width();
+    const int len = fit( text.data(), text.size(), width );
+
+    this->widget.write( text.data(), len, row, 0 );
+    this->widget.clear_line( row, width );
+}
+
+void cursesxx::Scrollback::write() {
+    const std::size_t bottom = this->top + this->rows();
+
+    for( std::size_t line = this->top; line < bottom; ++line )
+        this->draw( line );
+
+    this->shown = this->top;
+    this->drawn = std::min( this->end(), bottom );
+}
+
+/*
+ * Lines never change once pushed, so whatever is on screen and still in view
+ * is kept: the window is scrolled by however far the view moved, and only
+ * the rows that were not drawn before are rendered.
+ */
+void cursesxx::Scrollback::redraw() {
+    const std::size_t page = this->rows();
+    const std::size_t bottom = this->top + page;
+    const std::size_t moved = std::max( this->top, this->shown )
+        - std::min( this->top, this->shown );
+
+    if( moved >= page || this->drawn <= this->shown ) {
+        this->write();
+        this->widget.redraw();
+        return;
+    }
+
+    if( moved > 0 ) {
+        const int n = moved;
+        this->widget.scroll_up( this->top > this->shown ? n : -n );
+    }
+
+    const std::size_t keep_from = std::max( this->top, this->shown );
+    const std::size_t keep_to = std::min( this->drawn, bottom );
+
+    for( std::size_t line = this->top; line < bottom; ++line )
+        if( line < keep_from || line >= keep_to ) this->draw( line );
+
+    this->shown = this->top;
+    this->drawn = std::min( this->end(), bottom );
+    this->widget.redraw();
+}
+
+void cursesxx::Scrollback::decorate( const cursesxx::BorderStyle& b ) {
+    this->widget.decorate( b );
+}
+
+/* A view following the newest lines keeps following them */
+void cursesxx::Scrollback::place( int y, int x, int height, int width ) {
+    this->widget.place( y, x, height, width );
+    this->jump( this->follow ? this->end() : this->top );
+    this->write();
+}
+
+const cursesxx::Widget& cursesxx::Scrollback::get_widget() const {
+    return this->widget;
+}
+
+/*
+ * TABLE
+ */
+const std::size_t cursesxx::Table::none =
+    std::numeric_limits< std::size_t >::max();
+
+cursesxx::Text cursesxx::Table::Column::at( std::size_t row ) const {
+    const Cell& cell = this->cells[ row ];
+    return Text( this->text.data() + cell.offset, cell.length );
+}
+
+/*
+ * The widest cell only grows when a cell is added, and when the last cell
+ * of the widest width goes it falls to the next width in use. Each step down
+ * is paid for by the cell that went up there, so widths are kept up to date
+ * without ever looking at the other cells.
+ */
+void cursesxx::Table::Column::count( std::size_t width, bool added ) {
+    if( this->widths.size() <= width ) this->widths.resize( width + 1, 0 );
+
+    if( added ) {
+        ++this->widths[ width ];
+        this->widest = std::max( this->widest, width );
+        return;
+    }
+
+    --this->widths[ width ];
+    while( this->widest > 0 && this->widths[ this->widest ] == 0 )
+        --this->widest;
+}
+
+void cursesxx::Table::Column::push( const Text& value ) {
+    const std::size_t width = value.width();
+    const Cell cell = {
+        this->text.size(),
+        static_cast< std::uint32_t >( value.size() ),
+        static_cast< std::uint32_t >( width ),
+    };
+
+    this->text.append( value.data(), value.size() );
+    this->cells.push_back( cell );
+    this->count( width, true );
+}
+
+/*
+ * A value that fits where the old one was is written over it; a longer one
+ * goes at the end of the buffer. The space left behind is reclaimed once it
+ * is half of the buffer.
+ */
+void cursesxx::Table::Column::replace( std::size_t row, const Text& value ) {
+    const char* begin = this->text.data();
+    if( value.data() >= begin && value.data() < begin + this->text.size() ) {
+        const std::string copy( value.data(), value.size() );
+        this->replace( row, copy );
+        return;
+    }
+
+    Cell& cell = this->cells[ row ];
+    const std::size_t width = value.width();
+    this->count( cell.width, false );
+    this->count( width, true );
+
+    if( value.size() <= cell.length ) {
+        this->text.replace( cell.offset, value.size(),
+                value.data(), value.size() );
+        this->garbage += cell.length - value.size();
+    } else {
+        this->garbage += cell.length;
+        cell.offset = this->text.size();
+        this->text.append( value.data(), value.size() );
+    }
+
+    cell.length = value.size();
+    cell.width = width;
+
+    if( this->garbage > this->text.size() / 2 ) this->compact();
+}
+
+void cursesxx::Table::Column::compact() {
+    std::string packed;
+    packed.reserve( this->text.size() - this->garbage );
+
+    for( Cell& cell : this->cells ) {
+        const std::size_t offset = packed.size();
+        packed.append( this->text, cell.offset, cell.length );
+        cell.offset = offset;
+    }
+
+    this->text.swap( packed );
+    this->garbage = 0;
+}
+
+void cursesxx::Table::init() {
+    for( std::size_t i = 0; i < this->headings.size(); ++i )
+        this->data.push_back( std::make_shared< Column >() );
+}
+
+cursesxx::Table::~Table() {
+    {
+        std::lock_guard< std::mutex > guard( this->lock );
+        this->stopping = true;
+    }
+
+    this->wake.notify_one();
+    if( this->worker.joinable() ) this->worker.join();
+
+    /* a redraw() the worker posted may not have been applied yet */
+    if( Channel* channel = this->channel.load() ) channel->forget( this );
+}
+
+/*
+ * A column the worker still reads is copied before it is changed. The fence
+ * orders the worker's last reads, which end with it letting go of the
+ * column, before the changes.
+ */
+cursesxx::Table::Column& cursesxx::Table::column( std::size_t c ) {
+    std::shared_ptr< Column >& col = this->data[ c ];
+
+    if( col.use_count() != 1 )
+        col = std::make_shared< Column >( *col );
+
+    std::atomic_thread_fence( std::memory_order_acquire );
+    return *col;
+}
+
+static bool contains( const cursesxx::Text& text, const std::string& needle ) {
+    return std::search( text.data(), text.data() + text.size(),
+            needle.begin(), needle.end() ) != text.data() + text.size();
+}
+
+bool cursesxx::Table::passes( std::size_t row ) const {
+    return this->filter_column == none
+        || contains( this->data[ this->filter_column ]->at( row ),
+                this->needle );
+}
+
+/*
+ * Whether row is in view. Only a page of rows is looked at, so changes out
+ * of view cost no redraw.
+ */
+bool cursesxx::Table::visible( std::size_t row ) const {
+    const std::size_t end = std::min( this->order.size(),
+            this->top + this->page() );
+
+    for( std::size_t position = this->top; position < end; ++position )
+        if( this->order[ position ] == row ) return true;
+
+    return false;
+}
+
+void cursesxx::Table::push( std::size_t c, const Text& value ) {
+    const std::size_t widest = this->data[ c ]->widest;
+    this->column( c ).push( value );
+    if( this->data[ c ]->widest != widest ) this->stale = true;
+}
+
+void cursesxx::Table::append( std::size_t row ) {
+    ++this->count;
+    if( !this->passes( row ) ) return;
+
+    this->order.push_back( row );
+    if( this->visible( row ) ) this->stale = true;
+}
+
+std::size_t cursesxx::Table::add( std::initializer_list< Text > values ) {
+    const std::size_t row = this->count;
+    auto value = values.begin();
+
+    for( std::size_t c = 0; c < this->data.size(); ++c )
+        this->push( c, value != values.end() ? *value++ : "" );
+
+    this->append( row );
+    return row;
+}
+
+std::size_t cursesxx::Table::add( const std::vector< std::string >& values ) {
+    const std::size_t row = this->count;
+
+    for( std::size_t c = 0; c < this->data.size(); ++c )
+        this->push( c, c < values.size() ? Text( values[ c ] ) : "" );
+
+    this->append( row );
+    return row;
+}
+
+void cursesxx::Table::set( std::size_t row, std::size_t column,
+        const Text& value ) {
+    const std::size_t widest = this->data[ column ]->widest;
+    this->column( column ).replace( row, value );
+
+    if( this->data[ column ]->widest != widest || this->visible( row ) )
+        this->stale = true;
+}
+
+/* A sort or filter still under way is for rows that are gone; it is dropped */
+void cursesxx::Table::clear() {
+    {
+        std::lock_guard< std::mutex > guard( this->lock );
+        this->job.reset();
+    }
+
+    for( std::shared_ptr< Column >& col : this->data )
+        col = std::make_shared< Column >();
+
+    this->count = 0;
+    this->order.clear();
+    this->top = 0;
+    this->applied = ++this->requested;
+    this->stale = true;
+}
+
+cursesxx::Text cursesxx::Table::cell( std::size_t row,
+        std::size_t column ) const {
+    return this->data[ column ]->at( row );
+}
+
+std::size_t cursesxx::Table::rows() const {
+    return this->count;
+}
+
+std::size_t cursesxx::Table::columns() const {
+    return this->headings.size();
+}
+
+std::size_t cursesxx::Table::width( std::size_t column ) const {
+    return std::max( Text( this->headings[ column ] ).width(),
+            this->data[ column ]->widest );
+}
+
+std::size_t cursesxx::Table::listed() const {
+    return this->order.size();
+}
+
+std::size_t cursesxx::Table::row_at( std::size_t position ) const {
+    return this->order[ position ];
+}
+
+void cursesxx::Table::sort( std::size_t column, bool descending ) {
+    this->sort_column = column;
+    this->descending = descending;
+    this->schedule();
+}
+
+/* Filtering on column none shows every row again */
+void cursesxx::Table::filter( std::size_t column, std::string needle ) {
+    this->filter_column = column;
+    this->needle = std::move( needle );
+    this->schedule();
+}
+
+void cursesxx::Table::notify( Channel& channel ) {
+    this->channel.store( &channel );
+}
+
+bool cursesxx::Table::busy() const {
+    return this->applied != this->requested;
+}
+
+/*
+ * Hands the worker the columns it needs as they are now. A job it has not
+ * started on yet is replaced, as only the latest order is of any use.
+ */
+void cursesxx::Table::schedule() {
+    std::unique_ptr< Job > next( new Job );
+    next->generation = ++this->requested;
+    next->rows = this->count;
+    next->descending = this->descending;
+    next->needle = this->needle;
+
+    if( this->sort_column != none )
+        next->key = this->data[ this->sort_column ];
+    if( this->filter_column != none )
+        next->match = this->data[ this->filter_column ];
+
+    {
+        std::lock_guard< std::mutex > guard( this->lock );
+        this->job = std::move( next );
+        if( !this->worker.joinable() )
+            this->worker = std::thread( &Table::work, this );
+    }
+
+    this->wake.notify_one();
+}
+
+void cursesxx::Table::work() {
+    while( true ) {
+        std::unique_ptr< Job > current;
+
+        {
+            std::unique_lock< std::mutex > guard( this->lock );
+            this->wake.wait( guard, [this] {
+                return this->stopping || this->job;
+            } );
+
+            if( this->stopping ) return;
+            current = std::move( this->job );
+        }
+
+        std::shared_ptr< Result > result = std::make_shared< Result >();
+        result->generation = current->generation;
+        result->rows = current->rows;
+        arrange( *current, result->order );
+        current.reset();
+
+        std::atomic_store( &this->done, result );
+
+        Channel* channel = this->channel.load();
+        if( channel ) channel->post( this, [this] { this->redraw(); } );
+    }
+}
+
+namespace {
+
+    /*
+     * A numeric cell as a sort key, kept next to its row so that sorting
+     * walks one array instead of jumping between rows and keys.
+     */
+    struct Number {
+        double value;
+        std::uint32_t row;
+    };
+
+    bool parse( const cursesxx::Text& text, double& value ) {
+        char buffer[ 64 ];
+        if( text.empty() || text.size() >= sizeof( buffer ) ) return false;
+
+        std::memcpy( buffer, text.data(), text.size() );
+        buffer[ text.size() ] = '\0';
+
+        char* end;
+        value = std::strtod( buffer, &end );
+        return end == buffer + text.size() && value == value;
+    }
+
+}
+
+/*
+ * Orders the rows of a snapshot: the rows that pass the filter, sorted
+ * by the key column. Numbers and text are sorted apart, each on its own
+ * terms, and put together at the end. Rows whose keys are equal stay in the
+ * order they were added, in either direction.
+ */
+void cursesxx::Table::arrange( const Job& job, Order& order ) {
+    order.reserve( job.rows );
+
+    for( std::size_t row = 0; row < job.rows; ++row ) {
+        if( !job.match || contains( job.match->at( row ), job.needle ) )
+            order.push_back( row );
+    }
+
+    if( !job.key ) return;
+
+    const Column& key = *job.key;
+    const bool descending = job.descending;
+
+    std::vector< Number > numbers;
+    Order text;
+    text.reserve( order.size() );
+
+    for( std::uint32_t row : order ) {
+        Number n = { 0, row };
+        if( parse( key.at( row ), n.value ) ) numbers.push_back( n );
+        else                                  text.push_back( row );
+    }
+
+    std::sort( numbers.begin(), numbers.end(),
+        [=]( const Number& a, const Number& b ) {
+            if( a.value != b.value )
+                return descending ? b.value < a.value : a.value < b.value;
+            return a.row < b.row;
+        } );
+
+    std::sort( text.begin(), text.end(),
+        [&]( std::uint32_t a, std::uint32_t b ) {
+            const Cell& p = key.cells[ a ];
+            const Cell& q = key.cells[ b ];
+            int cmp = std::memcmp( key.text.data() + p.offset,
+                    key.text.data() + q.offset,
+                    std::min( p.length, q.length ) );
+
+            if( cmp == 0 ) cmp = ( q.length < p.length ) - ( p.length < q.length );
+            if( cmp == 0 ) return a < b;
+            return descending ? cmp > 0 : cmp < 0;
+        } );
+
+    order.clear();
+    if( descending ) order.insert( order.end(), text.begin(), text.end() );
+    for( const Number& n : numbers ) order.push_back( n.row );
+    if( !descending ) order.insert( order.end(), text.begin(), text.end() );
+}
+
+/*
+ * Swaps in the worker's order, unless a newer one has been asked for since.
+ * Rows added while the worker was busy follow the rows it ordered.
+ */
+void cursesxx::Table::adopt() {
+    std::shared_ptr< Result > result =
+        std::atomic_exchange( &this->done, std::shared_ptr< Result >() );
+
+    if( !result || result->generation != this->requested ) return;
+
+    this->order.swap( result->order );
+    for( std::size_t row = result->rows; row < this->count; ++row )
+        if( this->passes( row ) ) this->order.push_back( row );
+
+    this->applied = result->generation;
+    this->jump( this->top );
+    this->stale = true;
+}
+
+/* Rows below the headings */
+std::size_t cursesxx::Table::page() const {
+    return std::max( this->widget.height() - 1, 1 );
+}
+
+void cursesxx::Table::page_up() {
+    this->jump( this->top - std::min( this->top, this->page() ) );
+}
+
+void cursesxx::Table::page_down() {
+    this->jump( this->top + this->page() );
+}
+
+void cursesxx::Table::jump( std::size_t position ) {
+    const std::size_t listed = this->order.size();
+    const std::size_t last = listed - std::min( listed, this->page() );
+    const std::size_t top = std::min( position, last );
+
+    if( top != this->top ) this->stale = true;
+    this->top = top;
+}
+
+/*
+ * Lays a row out in the line buffer, every column padded to its width and
+ * followed by a space, and writes it in one go. Row none is the headings.
+ */
+void cursesxx::Table::draw( int y, std::size_t row ) {
+    const std::size_t edge = std::max( this->widget.width(), 0 );
+    std::size_t used = 0;
+    this->line.clear();
+
+    for( std::size_t c = 0; c < this->data.size() && used < edge; ++c ) {
+        const Text text = row == none
+            ? Text( this->headings[ c ] )
+            : this->data[ c ]->at( row );
+
+        const std::size_t room = std::min( this->width( c ), edge - used );
+        std::size_t cols = room;
+        const std::size_t len = fit( text.data(), text.size(), cols );
+        const std::size_t pad = std::min( room + 1, edge - used ) - cols;
+
+        this->line.append( text.data(), len );
+        this->line.append( pad, ' ' );
+        used += cols + pad;
+    }
+
+    this->widget.write( this->line.data(), this->line.size(), y, 0 );
+    this->widget.clear_line( y, used );
+}
+
+void cursesxx::Table::write() {
+    {
+        Format bold( this->widget, A_BOLD );
+        this->draw( 0, none );
+    }
+
+    const int height = this->widget.height();
+    for( int y = 1; y < height; ++y ) {
+        const std::size_t position = this->top + y - 1;
+
+        if( position < this->order.size() )
+            this->draw( y, this->order[ position ] );
+        else
+            this->widget.clear_line( y );
+    }
+
+    this->stale = false;
+}
+
+/* Only rewrites the rows in view if something changed since last time */
+void cursesxx::Table::redraw() {
+    this->adopt();
+    if( this->stale ) this->write();
+    this->widget.redraw();
+}
+
+void cursesxx::Table::decorate( const cursesxx::BorderStyle& b ) {
+    this->widget.decorate( b );
+    this->stale = true;
+}
+
+void cursesxx::Table::place( int y, int x, int height, int width ) {
+    this->widget.place( y, x, height, width );
+    this->jump( this->top );
+    this->write();
+}
+
+const cursesxx::Widget& cursesxx::Table::get_widget() const {
+    return this->widget;
+}
+
+/*
+ * CHART
+ */
+
+/*
+ * Folds v[0, n) into the running minimum, maximum and sum, a vector at a
+ * time where the target has vector units.
+ */
+static void extremes( const double* v, std::size_t n,
+        double& low, double& high, double& sum ) {
+    std::size_t pos = 0;
+
+#if defined( __AVX__ )
+    if( n >= 8 ) {
+        __m256d lo = _mm256_set1_pd( low );
+        __m256d hi = _mm256_set1_pd( high );
+        __m256d s = _mm256_setzero_pd();
+
+        for( ; pos + 4 <= n; pos += 4 ) {
+            const __m256d x = _mm256_loadu_pd( v + pos );
+            lo = _mm256_min_pd( lo, x );
+            hi = _mm256_max_pd( hi, x );
+            s = _mm256_add_pd( s, x );
+        }
+
+        double l[ 4 ], h[ 4 ], t[ 4 ];
+        _mm256_storeu_pd( l, lo );
+        _mm256_storeu_pd( h, hi );
+        _mm256_storeu_pd( t, s );
+        for( int i = 0; i < 4; ++i ) {
+            low = std::min( low, l[ i ] );
+            high = std::max( high, h[ i ] );
+            sum += t[ i ];
+        }
+    }
+#endif
+
+#if defined( __SSE2__ )
+    if( n - pos >= 4 ) {
+        __m128d lo = _mm_set1_pd( low );
+        __m128d hi = _mm_set1_pd( high );
+        __m128d s = _mm_setzero_pd();
+
+        for( ; pos + 2 <= n; pos += 2 ) {
+            const __m128d x = _mm_loadu_pd( v + pos );
+            lo = _mm_min_pd( lo, x );
+            hi = _mm_max_pd( hi, x );
+            s = _mm_add_pd( s, x );
+        }
+
+        double l[ 2 ], h[ 2 ], t[ 2 ];
+        _mm_storeu_pd( l, lo );
+        _mm_storeu_pd( h, hi );
+        _mm_storeu_pd( t, s );
+        for( int i = 0; i < 2; ++i ) {
+            low = std::min( low, l[ i ] );
+            high = std::max( high, h[ i ] );
+            sum += t[ i ];
+        }
+    }
+#endif
+
+    for( ; pos < n; ++pos ) {
+        low = std::min( low, v[ pos ] );
+        high = std::max( high, v[ pos ] );
+        sum += v[ pos ];
+    }
+}
+
+/* Where value falls on a scale of levels steps from low to high */
+static int level( double value, double low, double high, int levels ) {
+    if( !( high > low ) ) return levels / 2;
+
+    const double t = ( value - low ) / ( high - low );
+    const long step = std::lround( t * ( levels - 1 ) );
+    return std::min< long >( std::max< long >( step, 0 ), levels - 1 );
+}
+
+/* Appends U+2800 + dots, a braille pattern, as UTF-8 */
+static void braille( std::string& out, int dots ) {
+    out.push_back( char( 0xE2 ) );
+    out.push_back( char( 0xA0 | ( dots >> 6 ) ) );
+    out.push_back( char( 0x80 | ( dots & 0x3F ) ) );
+}
+
+/* Appends the block filling the lower eighths of a cell, U+2581-U+2588 */
+static void block( std::string& out, int eighths ) {
+    out.push_back( char( 0xE2 ) );
+    out.push_back( char( 0x96 ) );
+    out.push_back( char( 0x80 + eighths ) );
+}
+
+void cursesxx::Chart::push( double sample ) {
+    const std::size_t capacity = this->ring.size();
+    std::size_t slot = this->head + this->count;
+    if( slot >= capacity ) slot -= capacity;
+
+    this->ring[ slot ] = sample;
+
+    if( this->count < capacity ) ++this->count;
+    else if( ++this->head == capacity ) this->head = 0;
+
+    this->stale = true;
+}
+
+void cursesxx::Chart::clear() {
+    this->head = 0;
+    this->count = 0;
+    this->stale = true;
+}
+
+std::size_t cursesxx::Chart::size() const {
+    return this->count;
+}
+
+void cursesxx::Chart::style( Style s ) {
+    this->style_ = s;
+    this->stale = true;
+}
+
+void cursesxx::Chart::range( double low, double high ) {
+    this->fixed = true;
+    this->low = low;
+    this->high = high;
+    this->stale = true;
+}
+
+void cursesxx::Chart::autoscale() {
+    this->fixed = false;
+    this->stale = true;
+}
+
+/* Reduces samples [from, to), oldest first, which may wrap around the ring */
+void cursesxx::Chart::reduce( std::size_t from, std::size_t to,
+        Bucket& bucket ) const {
+    const std::size_t capacity = this->ring.size();
+    std::size_t start = this->head + from;
+    if( start >= capacity ) start -= capacity;
+
+    const std::size_t n = to - from;
+    const std::size_t first = std::min( n, capacity - start );
+
+    extremes( this->ring.data() + start, first,
+            bucket.low, bucket.high, bucket.sum );
+    extremes( this->ring.data(), n - first,
+            bucket.low, bucket.high, bucket.sum );
+    bucket.count = n;
+}
+
+/*
+ * Splits the samples into at most n buckets of (nearly) equal size. With
+ * fewer samples than that, every sample gets a bucket of its own.
+ */
+void cursesxx::Chart::decimate( std::size_t n ) {
+    const std::size_t k = std::min( n, this->count );
+    this->buckets.resize( k );
+
+    for( std::size_t i = 0; i < k; ++i ) {
+        Bucket& bucket = this->buckets[ i ];
+        bucket.low = std::numeric_limits< double >::infinity();
+        bucket.high = -std::numeric_limits< double >::infinity();
+        bucket.sum = 0;
+        this->reduce( i * this->count / k, ( i + 1 ) * this->count / k,
+                bucket );
+    }
+}
+
+void cursesxx::Chart::draw_bars( int height, int width ) {
+    const int k = this->buckets.size();
+
+    if( !this->fixed ) {
+        this->low = std::numeric_limits< double >::infinity();
+        this->high = -std::numeric_limits< double >::infinity();
+        for( const Bucket& b : this->buckets ) {
+            this->low = std::min( this->low, b.sum / b.count );
+            this->high = std::max( this->high, b.sum / b.count );
+        }
+    }
+
+    /* at least one eighth, so the lowest samples still show */
+    this->levels.resize( k );
+    for( int i = 0; i < k; ++i ) {
+        const Bucket& b = this->buckets[ i ];
+        this->levels[ i ] = 1 + level( b.sum / b.count,
+                this->low, this->high, height * 8 );
+    }
+
+    for( int y = 0; y < height; ++y ) {
+        const int base = ( height - 1 - y ) * 8;
+        this->line.assign( width - k, ' ' );
+
+        for( int i = 0; i < k; ++i ) {
+            const int fill = std::min( this->levels[ i ] - base, 8 );
+            if( fill > 0 ) block( this->line, fill );
+            else           this->line.push_back( ' ' );
+        }
+
+        this->widget.write( this->line.data(), this->line.size(), y, 0 );
+    }
+}
+
+/*
+ * Braille cells are two dots wide and four high. Bucket i is dot column
+ * i of the chart; its dots run from the level of its minimum to the level
+ * of its maximum.
+ */
+void cursesxx::Chart::draw_dots( int height, int width ) {
+    static const int left[] = { 0x01, 0x02, 0x04, 0x40 };
+    static const int right[] = { 0x08, 0x10, 0x20, 0x80 };
+
+    const int k = this->buckets.size();
+    const int levels = height * 4;
+
+    if( !this->fixed ) {
+        this->low = std::numeric_limits< double >::infinity();
+        this->high = -std::numeric_limits< double >::infinity();
+        for( const Bucket& b : this->buckets ) {
+            this->low = std::min( this->low, b.low );
+            this->high = std::max( this->high, b.high );
+        }
+    }
+
+    this->levels.resize( 2 * k );
+    for( int i = 0; i < k; ++i ) {
+        const Bucket& b = this->buckets[ i ];
+        this->levels[ 2 * i ] = level( b.low, this->low, this->high, levels );
+        this->levels[ 2 * i + 1 ] =
+            level( b.high, this->low, this->high, levels );
+    }
+
+    /* the dot column of the first bucket, so the newest is rightmost */
+    const int first = 2 * width - k;
+
+    for( int y = 0; y < height; ++y ) {
+        const int top = ( height - y ) * 4 - 1;
+        this->line.clear();
+
+        for( int x = 0; x < width; ++x ) {
+            int dots = 0;
+
+            for( int side = 0; side < 2; ++side ) {
+                const int i = 2 * x + side - first;
+                if( i < 0 ) continue;
+
+                const int* bits = side == 0 ? left : right;
+                for( int d = 0; d < 4; ++d ) {
+                    const int l = top - d;
+                    if( l >= this->levels[ 2 * i ]
+                            && l <= this->levels[ 2 * i + 1 ] )
+                        dots |= bits[ d ];
+                }
+            }
+
+            if( dots ) braille( this->line, dots );
+            else       this->line.push_back( ' ' );
+        }
+
+        this->widget.write( this->line.data(), this->line.size(), y, 0 );
+    }
+}
+
+void cursesxx::Chart::write() {
+    const int height = this->widget.height();
+    const int width = this->widget.width();
+    this->stale = false;
+
+    if( height <= 0 || width <= 0 ) return;
+
+    if( this->style_ == bars ) {
+        this->decimate( width );
+        this->draw_bars( height, width );
+    } else {
+        this->decimate( 2 * width );
+        this->draw_dots( height, width );
+    }
+}
+
+/* However many samples were pushed since, the chart is drawn once */
+void cursesxx::Chart::redraw() {
+    if( this->stale ) this->write();
+    this->widget.redraw();
+}
+
+void cursesxx::Chart::decorate( const cursesxx::BorderStyle& b ) {
+    this->widget.decorate( b );
+    this->stale = true;
+}
+
+void cursesxx::Chart::place( int y, int x, int height, int width ) {
+    this->widget.place( y, x, height, width );
+    this->write();
+}
+
+const cursesxx::Widget& cursesxx::Chart::get_widget() const {
+    return this->widget;
+}
+
+/*
+ * EDITOR
+ */
+
+void cursesxx::Editor::multiline( bool enable ) {
+    this->multiline_ = enable;
+}
+
+void cursesxx::Editor::completions( const Trie* words ) {
+    this->words = words;
+}
+
+void cursesxx::Editor::on_submit(
+        std::function< void( const std::string& ) > f ) {
+    this->submitted = std::move( f );
+}
+
+std::string cursesxx::Editor::text() const {
+    return this->buffer.str();
+}
+
+std::size_t cursesxx::Editor::cursor() const {
+    return this->buffer.cursor();
+}
+
+std::size_t cursesxx::Editor::start_of( std::size_t pos ) const {
+    while( pos > 0 && this->buffer.at( pos - 1 ) != '\n' ) --pos;
+    return pos;
+}
+
+std::size_t cursesxx::Editor::end_of( std::size_t pos ) const {
+    const std::size_t size = this->buffer.size();
+    while( pos < size && this->buffer.at( pos ) != '\n' ) ++pos;
+    return pos;
+}
+
+/* The columns text[from, to) takes up */
+std::size_t cursesxx::Editor::span( std::size_t from, std::size_t to ) {
+    this->row.clear();
+    this->buffer.copy( from, to - from, this->row );
+    return columns( this->row.data(), this->row.size() );
+}
+
+/*
+ * Edits and steps keep the cursor's column up to date by what they pass
+ * over; only a jump into the middle of a line measures it from the start.
+ */
+void cursesxx::Editor::measure() {
+    this->col = this->span( this->line_start, this->buffer.cursor() );
+}
+
+/*
+ * Moves the column on from from to to, further along the cursor's line,
+ * and returns the column the change starts at. Keys bring in UTF-8 a byte
+ * at a time, which can leave from inside a character; that character is
+ * measured again from where it starts.
+ */
+std::size_t cursesxx::Editor::advance( std::size_t from, std::size_t to ) {
+    std::size_t start = from;
+    while( start > this->line_start
+            && continuation( this->buffer.at( start ) ) )
+        --start;
+
+    this->col -= this->span( start, from );
+    const std::size_t changed = this->col;
+    this->col += this->span( start, to );
+    return changed;
+}
+
+/* The word before the cursor, back to the last blank */
+std::string cursesxx::Editor::word() const {
+    const std::size_t cursor = this->buffer.cursor();
+    std::size_t start = cursor;
+    while( start > 0 ) {
+        const char c = this->buffer.at( start - 1 );
+        if( c == ' ' || c == '\t' || c == '\n' ) break;
+        --start;
+    }
+
+    std::string word;
+    this->buffer.copy( start, cursor - start, word );
+    return word;
+}
+
+/*
+ * Anything typed after stepping back in the history is a new draft. The
+ * column kept for moving up and down goes with any other change.
+ */
+void cursesxx::Editor::edited() {
+    this->back = 0;
+    this->goal = std::string::npos;
+}
+
+/*
+ * Scrolls the view to the cursor, redrawing everything if it moved, and
+ * marks the cells the cursor leaves and enters.
+ */
+void cursesxx::Editor::follow() {
+    const std::size_t height = std::max( this->widget.height(), 1 );
+    const std::size_t width = std::max( this->widget.width(), 1 );
+
+    if( this->line < this->top ) {
+        this->top = this->line;
+        this->top_start = this->line_start;
+        this->damage.mark();
+    } else if( this->line >= this->top + height ) {
+        this->top = this->line - height + 1;
+        this->top_start = this->line_start;
+        for( std::size_t n = 1; n < height; ++n )
+            this->top_start = this->start_of( this->top_start - 1 );
+        this->damage.mark();
+    }
+
+    if( this->col < this->left ) {
+        this->left = this->col;
+        this->damage.mark();
+    } else if( this->col >= this->left + width ) {
+        this->left = this->col - width + 1;
+        this->damage.mark();
+    }
+
+    if( this->focused )
+        this->damage.mark( this->cursor_row,
+                this->cursor_col, this->cursor_col );
+
+    this->cursor_row = this->line - this->top;
+    this->cursor_col = this->col - this->left;
+
+    if( this->focused )
+        this->damage.mark( this->cursor_row,
+                this->cursor_col, this->cursor_col );
+}
+
+/* Inserts text without newlines at the cursor; its row changes from there */
+void cursesxx::Editor::insert_line( const char* text, std::size_t len ) {
+    if( len == 0 ) return;
+
+    const std::size_t cursor = this->buffer.cursor();
+    this->buffer.insert( text, len );
+
+    const int from = this->advance( cursor, cursor + len ) - this->left;
+    this->damage.mark( this->line - this->top, std::max( from, 0 ),
+            std::numeric_limits< int >::max() );
+}
+
+/*
+ * A line break redraws every row from the cursor's down. A single line
+ * editor takes newlines as blanks.
+ */
+void cursesxx::Editor::insert( const Text& str ) {
+    const char* text = str.data();
+    std::size_t len = str.size();
+
+    while( true ) {
+        const void* nl = std::memchr( text, '\n', len );
+        const std::size_t n = nl
+            ? static_cast< const char* >( nl ) - text
+            : len;
+
+        this->insert_line( text, n );
+        if( n == len ) break;
+
+        if( this->multiline_ ) {
+            this->damage.mark_rows( this->line - this->top,
+                    std::max( this->widget.height(), 1 ) - 1 );
+            this->buffer.insert( "\n", 1 );
+            this->line_start = this->buffer.cursor();
+            this->col = 0;
+            ++this->line;
+        } else {
+            this->insert_line( " ", 1 );
+        }
+
+        text += n + 1;
+        len -= n + 1;
+    }
+
+    this->edited();
+    this->follow();
+}
+
+void cursesxx::Editor::erase_before() {
+    std::size_t cursor = this->buffer.cursor();
+    if( cursor == 0 ) return;
+
+    /* stray continuation bytes go on their own, not with a newline */
+    std::size_t n = 1;
+    while( n < cursor && continuation( this->buffer.at( cursor - n ) ) ) ++n;
+    if( n > 1 && plain( this->buffer.at( cursor - n ) ) ) --n;
+
+    const bool join = this->buffer.at( cursor - 1 ) == '\n';
+    const int row = this->line - this->top;
+
+    if( !join ) this->col -= this->span( cursor - n, cursor );
+    this->buffer.erase_before( n );
+    cursor -= n;
+
+    if( join ) {
+        --this->line;
+        this->line_start = this->start_of( cursor );
+        this->measure();
+        this->damage.mark_rows( row - 1,
+                std::max( this->widget.height(), 1 ) - 1 );
+    } else {
+        const int from = this->col - this->left;
+        this->damage.mark( row, std::max( from, 0 ),
+                std::numeric_limits< int >::max() );
+    }
+
+    this->edited();
+    this->follow();
+}
+
+void cursesxx::Editor::erase_after() {
+    const std::size_t cursor = this->buffer.cursor();
+    const std::size_t size = this->buffer.size();
+    if( cursor == size ) return;
+
+    std::size_t n = 1;
+    while( cursor + n < size && continuation( this->buffer.at( cursor + n ) ) )
+        ++n;
+
+    const int row = this->line - this->top;
+    const int from = this->col - this->left;
+
+    if( this->buffer.at( cursor ) == '\n' )
+        this->damage.mark_rows( row,
+                std::max( this->widget.height(), 1 ) - 1 );
+    else
+        this->damage.mark( row, std::max( from, 0 ),
+                std::numeric_limits< int >::max() );
+
+    this->buffer.erase_after( n );
+    this->edited();
+    this->follow();
+}
+
+/* Moves the cursor a character, across line breaks */
+void cursesxx::Editor::step( bool forward ) {
+    std::size_t cursor = this->buffer.cursor();
+    const std::size_t from = cursor;
+
+    if( forward ) {
+        const std::size_t size = this->buffer.size();
+        if( cursor == size ) return;
+
+        if( this->buffer.at( cursor++ ) == '\n' ) {
+            ++this->line;
+            this->line_start = cursor;
+            this->col = 0;
+        } else {
+            while( cursor < size && continuation( this->buffer.at( cursor ) ) )
+                ++cursor;
+            this->advance( from, cursor );
+        }
+    } else {
+        if( cursor == 0 ) return;
+
+        --cursor;
+        /* as in erase_before(), stray continuation bytes go on their own */
+        while( cursor > 0 && continuation( this->buffer.at( cursor ) ) )
+            --cursor;
+        if( from - cursor > 1 && plain( this->buffer.at( cursor ) ) )
+            ++cursor;
+
+        if( this->buffer.at( cursor ) == '\n' ) {
+            --this->line;
+            this->line_start = this->start_of( cursor );
+            this->col = this->span( this->line_start, cursor );
+        } else {
+            this->col -= this->span( cursor, from );
+        }
+    }
+
+    this->buffer.seek( cursor );
+    this->goal = std::string::npos;
+    this->follow();
+}
+
+/* Moves to the line above or below, as near the kept column as it goes */
+void cursesxx::Editor::vertical( bool down ) {
+    if( this->goal == std::string::npos ) this->goal = this->col;
+
+    std::size_t start;
+    if( down ) {
+        const std::size_t end = this->end_of( this->buffer.cursor() );
+        if( end == this->buffer.size() ) return;
+        start = end + 1;
+        ++this->line;
+    } else {
+        if( this->line_start == 0 ) return;
+        start = this->start_of( this->line_start - 1 );
+        --this->line;
+    }
+
+    this->row.clear();
+    this->buffer.copy( start, this->end_of( start ) - start, this->row );
+    std::size_t cols = this->goal;
+    const std::size_t n = fit( this->row.data(), this->row.size(), cols );
+
+    this->line_start = start;
+    this->col = cols;
+    this->buffer.seek( start + n );
+    this->follow();
+}
+
+void cursesxx::Editor::home() {
+    this->buffer.seek( this->line_start );
+    this->col = 0;
+    this->goal = std::string::npos;
+    this->follow();
+}
+
+void cursesxx::Editor::end() {
+    const std::size_t cursor = this->buffer.cursor();
+    const std::size_t end = this->end_of( cursor );
+
+    if( end > cursor ) this->advance( cursor, end );
+    this->buffer.seek( end );
+    this->goal = std::string::npos;
+    this->follow();
+}
+
+void cursesxx::Editor::complete() {
+    const std::string extension = this->words->common( this->word() );
+    if( !extension.empty() ) this->insert( extension );
+}
+
+std::size_t cursesxx::Editor::suggestions( std::size_t limit,
+        std::vector< std::string >& out ) const {
+
+    if( !this->words ) {
+        out.clear();
+        return 0;
+    }
+
+    return this->words->complete( this->word(), limit, out );
+}
+
+/* Shows text with the cursor at its end, the view scrolled to the start */
+void cursesxx::Editor::replace( const char* text, std::size_t len ) {
+    this->buffer.assign( text, len );
+    this->line = std::count( text, text + len, '\n' );
+    this->line_start = this->start_of( len );
+    this->measure();
+    this->top = 0;
+    this->top_start = 0;
+    this->left = 0;
+    this->goal = std::string::npos;
+    this->damage.mark();
+    this->follow();
+}
+
+void cursesxx::Editor::set( const Text& str ) {
+    this->replace( str.data(), str.size() );
+    this->back = 0;
+}
+
+/*
+ * Steps one entry back or forward in the history. What was being typed is
+ * kept aside while stepping through it and comes back past the newest.
+ */
+void cursesxx::Editor::recall( bool older ) {
+    if( older ) {
+        if( this->back == this->count ) return;
+        if( this->back == 0 ) this->draft = this->buffer.str();
+        ++this->back;
+    } else {
+        if( this->back == 0 ) return;
+        --this->back;
+    }
+
+    if( this->back == 0 ) {
+        this->replace( this->draft.data(), this->draft.size() );
+        return;
+    }
+
+    const std::string& entry = this->history[
+        ( this->head + this->count - this->back ) % this->history.size() ];
+    this->replace( entry.data(), entry.size() );
+}
+
+/*
+ * The text goes into the history unless it is empty or the same as the
+ * newest entry. The oldest entry's string is reused when the ring is full.
+ */
+void cursesxx::Editor::submit() {
+    const std::string text = this->buffer.str();
+
+    const std::size_t capacity = this->history.size();
+    if( capacity > 0 && !text.empty() ) {
+        const std::size_t newest = ( this->head + this->count + capacity - 1 )
+            % capacity;
+
+        if( this->count == 0 || this->history[ newest ] != text ) {
+            std::size_t slot = ( this->head + this->count ) % capacity;
+            if( this->count == capacity ) {
+                slot = this->head;
+                this->head = ( this->head + 1 ) % capacity;
+            } else {
+                ++this->count;
+            }
+
+            this->history[ slot ] = text;
+        }
+    }
+
+    this->set( "" );
+    if( this->submitted ) this->submitted( text );
+}
+
+bool cursesxx::Editor::key( int key ) {
+    switch( key ) {
+        case KEY_LEFT:  this->step( false ); return true;
+        case KEY_RIGHT: this->step( true ); return true;
+        case KEY_HOME:
+        case 1:         this->home(); return true;
+        case KEY_END:
+        case 5:         this->end(); return true;
+
+        case KEY_BACKSPACE:
+        case 127:
+        case 8:         this->erase_before(); return true;
+        case KEY_DC:    this->erase_after(); return true;
+
+        case KEY_UP:
+            if( this->multiline_ && this->line > 0 ) this->vertical( false );
+            else this->recall( true );
+            return true;
+
+        case KEY_DOWN:
+            if( this->multiline_
+                    && this->end_of( this->buffer.cursor() )
+                        < this->buffer.size() )
+                this->vertical( true );
+            else this->recall( false );
+            return true;
+
+        case '\t':
+            if( !this->words ) return false;
+            this->complete();
+            return true;
+
+        case KEY_ENTER:
+            this->submit();
+            return true;
+
+        case '\n':
+        case '\r':
+            if( this->multiline_ ) this->insert( "\n" );
+            else this->submit();
+            return true;
+    }
+
+    if( key < ' ' || key > 0xFF || key == 127 ) return false;
+
+    const char c = key;
+    this->insert( Text( &c, 1 ) );
+    return true;
+}
+
+void cursesxx::Editor::focus() {
+    this->focused = true;
+    this->damage.mark( this->cursor_row, this->cursor_col, this->cursor_col );
+    this->redraw();
+}
+
+void cursesxx::Editor::unfocus() {
+    this->focused = false;
+    this->damage.mark( this->cursor_row, this->cursor_col, this->cursor_col );
+    this->redraw();
+}
+
+/*
+ * Draws row y from column from to its end. start is where the line shown
+ * on the row starts, or npos for a row past the last line.
+ */
+void cursesxx::Editor::draw( int y, std::size_t start, int from ) {
+    if( start == std::string::npos ) {
+        this->widget.clear_line( y, from );
+        return;
+    }
+
+    this->row.clear();
+    this->buffer.copy( start, this->end_of( start ) - start, this->row );
+    const char* text = this->row.data();
+    const std::size_t len = this->row.size();
+
+    /* a wide character cut by the left edge of the view is left out */
+    std::size_t skipped = this->left + from;
+    std::size_t pos = fit( text, len, skipped );
+    if( skipped < this->left && pos < len ) {
+        wchar_t c;
+        pos += decode( text, len, pos, c );
+        skipped += glyph_width( c );
+    }
+
+    const int x = std::max< int >( skipped - this->left, 0 );
+    std::size_t cols = std::max( this->widget.width() - x, 0 );
+    const std::size_t n = fit( text + pos, len - pos, cols );
+
+    if( x > from ) this->widget.clear_line( y, from );
+    this->widget.write( text + pos, n, y, x );
+    this->widget.clear_line( y, x + cols );
+}
+
+/* Draws the rows that changed, and the cursor over them */
+void cursesxx::Editor::layout() {
+    const int height = this->widget.height();
+
+    if( height > 0 && this->widget.width() > 0 ) {
+        std::size_t start = this->top_start;
+
+        for( int y = 0; y < height; ++y ) {
+            if( this->damage.dirty( y ) )
+                this->draw( y, start, std::max( this->damage.first( y ), 0 ) );
+
+            if( start == std::string::npos ) continue;
+            const std::size_t end = this->end_of( start );
+            start = end < this->buffer.size() ? end + 1 : std::string::npos;
+        }
+
+        if( this->focused && this->damage.dirty( this->cursor_row ) ) {
+            const std::size_t cursor = this->buffer.cursor();
+            const std::size_t size = this->buffer.size();
+
+            this->row.clear();
+            if( cursor < size && this->buffer.at( cursor ) != '\n' ) {
+                std::size_t n = 1;
+                while( cursor + n < size
+                        && continuation( this->buffer.at( cursor + n ) ) )
+                    ++n;
+                this->buffer.copy( cursor, n, this->row );
+            } else {
+                this->row.push_back( ' ' );
+            }
+
+            Format reverse( this->widget, A_REVERSE );
+            this->widget.write( this->row.data(), this->row.size(),
+                    this->cursor_row, this->cursor_col );
+        }
+    }
+
+    this->damage.reset();
+}
+
+void cursesxx::Editor::write() {
+    this->damage.mark();
+    this->layout();
+}
+
+void cursesxx::Editor::redraw() {
+    if( !this->damage.clean() ) this->layout();
+    this->widget.redraw();
+}
+
+void cursesxx::Editor::decorate( const cursesxx::BorderStyle& b ) {
+    this->widget.decorate( b );
+}
+
+void cursesxx::Editor::place( int y, int x, int height, int width ) {
+    this->widget.place( y, x, height, width );
+    this->top = this->line;
+    this->top_start = this->line_start;
+    this->left = 0;
+    this->follow();
+    this->write();
+}
+
+const cursesxx::Widget& cursesxx::Editor::get_widget() const {
+    return this->widget;
+}
+
+/*
+ * SELECTOR
+ */
+const std::size_t cursesxx::Selector::none =
+    std::numeric_limits< std::size_t >::max();
+
+namespace {
+
+    /* candidates a thread takes at a time, between checks for cancelling */
+    const std::size_t chunk_size = 1 << 14;
+
+    char fold( char c ) {
+        return c >= 'A' && c <= 'Z' ? c + ( 'a' - 'A' ) : c;
+    }
+
+    bool alnum( unsigned char c ) {
+        return ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' )
+            || ( c >= '0' && c <= '9' ) || c >= 0x80;
+    }
+
+    /*
+     * The bit a folded byte sets in a mask: one each for letters and
+     * digits, the other ASCII bytes sharing the rest, and one for all of
+     * UTF-8. An item cannot match a query with bits it does not have.
+     */
+    std::uint64_t bit( char c ) {
+        const unsigned char b = c;
+        if( b >= 'a' && b <= 'z' ) return std::uint64_t( 1 ) << ( b - 'a' );
+        if( b >= '0' && b <= '9' ) return std::uint64_t( 1 ) << ( 26 + b - '0' );
+        if( b >= 0x80 ) return std::uint64_t( 1 ) << 63;
+        return std::uint64_t( 1 ) << ( 36 + b % 27 );
+    }
+
+    std::uint64_t signature( const char* text, std::size_t len ) {
+        std::uint64_t mask = 0;
+        for( std::size_t i = 0; i < len; ++i ) mask |= bit( fold( text[ i ] ) );
+        return mask;
+    }
+
+    /* How much a byte matched at i is worth for starting a word */
+    int boundary( const char* text, std::size_t i ) {
+        if( i == 0 ) return 10;
+
+        const unsigned char prev = text[ i - 1 ];
+        const unsigned char c = text[ i ];
+        if( !alnum( prev ) ) return 8;
+        if( prev >= 'a' && prev <= 'z' && c >= 'A' && c <= 'Z' ) return 7;
+        if( !( prev >= '0' && prev <= '9' ) && c >= '0' && c <= '9' ) return 7;
+        return 0;
+    }
+
+    /*
+     * Scores text against a folded query, if it matches. Going forward
+     * finds where the query first ends. Going back from there, every byte
+     * is matched as late as it can be, which favours runs at the end and
+     * starts of words, and the match is scored on the way: every byte
+     * matched counts, more so in a run or at the start of a word, and gaps
+     * count against.
+     */
+    bool fuzzy( const char* text, std::size_t len, const std::string& query,
+            int& score ) {
+
+        const std::size_t n = query.size();
+        std::size_t q = 0;
+        std::size_t end = 0;
+
+        for( ; end < len; ++end )
+            if( fold( text[ end ] ) == query[ q ] && ++q == n ) break;
+
+        if( q < n ) return false;
+
+        score = 0;
+        int gap = 0;
+        bool run = false;
+
+        for( std::size_t i = end + 1; q > 0; ) {
+            if( fold( text[ --i ] ) != query[ q - 1 ] ) {
+                score -= gap++ ? 1 : 3;
+                run = false;
+                continue;
+            }
+
+            const int bonus = boundary( text, i );
+            score += 16 + ( q == 1 ? 2 * bonus : bonus ) + ( run ? 4 : 0 );
+            run = true;
+            gap = 0;
+            --q;
+        }
+
+        return true;
+    }
+
+    /* Whether every byte of part appears in whole, in order */
+    bool subsequence( const std::string& part, const std::string& whole ) {
+        std::size_t p = 0;
+        for( std::size_t i = 0; i < whole.size() && p < part.size(); ++i )
+            if( whole[ i ] == part[ p ] ) ++p;
+        return p == part.size();
+    }
+
+    /* Whether s does not end part way through a UTF-8 character */
+    bool whole( const std::string& s ) {
+        std::size_t n = 0;
+        while( n < s.size() && continuation( s[ s.size() - 1 - n ] ) ) ++n;
+        if( n == s.size() ) return true;
+
+        const unsigned char lead = s[ s.size() - 1 - n ];
+        return n >= std::size_t( lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2
+                : lead >= 0xC0 ? 1 : 0 );
+    }
+
+    struct Hit {
+        int score;
+        std::uint32_t length;
+        std::uint32_t item;
+    };
+
+    bool better( const Hit& a, const Hit& b ) {
+        if( a.score != b.score ) return a.score > b.score;
+        if( a.length != b.length ) return a.length < b.length;
+        return a.item < b.item;
+    }
+
+}
+
+struct cursesxx::Selector::Search {
+    unsigned long generation;
+    std::shared_ptr< const Items > items;
+    std::string query;
+    std::uint64_t mask;
+    std::size_t depth;
+
+    /* the candidates: an earlier query's matches, then the items after it */
+    const Order* base;
+    std::size_t from;
+    std::size_t total;
+    std::size_t chunks;
+    std::atomic< std::size_t > next{ 0 };
+
+    /* the matches by chunk, and the best of every thread's */
+    std::vector< Order > found;
+    std::mutex lock;
+    std::vector< Hit > best;
+
+    /* helpers yet to finish, under the Selector's lock */
+    std::size_t active;
+};
+
+cursesxx::Text cursesxx::Selector::Items::at( std::size_t i ) const {
+    return Text( this->text.data() + this->starts[ i ],
+            this->starts[ i + 1 ] - this->starts[ i ] );
+}
+
+void cursesxx::Selector::Items::push( const Text& value ) {
+    this->text.append( value.data(), value.size() );
+    this->starts.push_back( this->text.size() );
+    this->masks.push_back( signature( value.data(), value.size() ) );
+}
+
+/* A search in progress is cancelled rather than waited for */
+cursesxx::Selector::~Selector() {
+    {
+        std::lock_guard< std::mutex > guard( this->lock );
+        this->stopping = true;
+        ++this->requested;
+    }
+
+    this->wake.notify_one();
+    this->start.notify_all();
+    if( this->worker.joinable() ) this->worker.join();
+    for( std::thread& helper : this->helpers ) helper.join();
+
+    if( Channel* channel = this->channel.load() ) channel->forget( this );
+}
+
+/* Items a search still reads are copied first, like a Table's columns */
+cursesxx::Selector::Items& cursesxx::Selector::own() {
+    if( this->items.use_count() != 1 )
+        this->items = std::make_shared< Items >( *this->items );
+
+    std::atomic_thread_fence( std::memory_order_acquire );
+    this->stale = true;
+    return *this->items;
+}
+
+std::size_t cursesxx::Selector::add( const Text& value ) {
+    this->own().push( value );
+    return this->size() - 1;
+}
+
+void cursesxx::Selector::add( const std::vector< std::string >& values ) {
+    Items& items = this->own();
+    for( const std::string& value : values ) items.push( value );
+}
+
+void cursesxx::Selector::clear() {
+    this->items = std::make_shared< Items >();
+    ++this->epoch;
+    this->shown.reset();
+    this->cursor = this->top = 0;
+    if( !this->query_.empty() ) this->schedule( 0 );
+    this->write();
+}
+
+std::size_t cursesxx::Selector::size() const {
+    return this->items->starts.size() - 1;
+}
+
+cursesxx::Text cursesxx::Selector::item( std::size_t i ) const {
+    return this->items->at( i );
+}
+
+void cursesxx::Selector::search( std::string query ) {
+    this->query_ = std::move( query );
+    this->schedule( 0 );
+}
+
+const std::string& cursesxx::Selector::query() const {
+    return this->query_;
+}
+
+void cursesxx::Selector::on_select( std::function< void( std::size_t ) > f ) {
+    this->selected_ = std::move( f );
+}
+
+void cursesxx::Selector::notify( Channel& channel ) {
+    this->channel.store( &channel );
+}
+
+void cursesxx::Selector::threads( unsigned n ) {
+    this->threads_ = std::max( n, 1u );
+}
+
+std::size_t cursesxx::Selector::matched() const {
+    return this->shown ? this->shown->matches.size() : this->size();
+}
+
+std::size_t cursesxx::Selector::listed() const {
+    return this->shown ? this->shown->best.size() : this->size();
+}
+
+std::size_t cursesxx::Selector::item_at( std::size_t position ) const {
+    return this->shown ? this->shown->best[ position ] : position;
+}
+
+std::size_t cursesxx::Selector::selected() const {
+    return this->cursor < this->listed()
+        ? this->item_at( this->cursor )
+        : none;
+}
+
+bool cursesxx::Selector::busy() const {
+    return this->applied != this->requested;
+}
+
+bool cursesxx::Selector::key( int key ) {
+    switch( key ) {
+        case KEY_UP:
+        case 16:        this->move( -1 ); return true;
+        case KEY_DOWN:
+        case 14:        this->move( 1 ); return true;
+        case KEY_PPAGE: this->move( -std::ptrdiff_t( this->page() ) ); return true;
+        case KEY_NPAGE: this->move( this->page() ); return true;
+
+        case KEY_BACKSPACE:
+        case 127:
+        case 8: {
+            if( this->query_.empty() ) return true;
+
+            std::size_t n = this->query_.size() - 1;
+            while( n > 0 && continuation( this->query_[ n ] ) ) --n;
+            this->query_.erase( n );
+            this->schedule( 0 );
+            return true;
+        }
+
+        case 21:
+            this->query_.clear();
+            this->schedule( 0 );
+            return true;
+
+        case KEY_ENTER:
+        case '\n':
+        case '\r':
+            if( this->selected_ && this->selected() != none )
+                this->selected_( this->selected() );
+            return true;
+    }
+
+    if( key < ' ' || key > 0xFF || key == 127 ) return false;
+
+    /* UTF-8 comes in a byte at a time; search once the character is whole */
+    this->query_.push_back( char( key ) );
+    if( whole( this->query_ ) ) this->schedule( 0 );
+    return true;
+}
+
+/*
+ * Hands the worker the query, and the items as they are now, cancelling the
+ * search before it. The empty query needs no search: it lists every item.
+ */
+void cursesxx::Selector::schedule( std::size_t depth ) {
+    const unsigned long generation = ++this->requested;
+    this->depth = std::max( { depth, std::size_t( 256 ), 2 * this->page() } );
+    this->stale = true;
+
+    if( this->query_.empty() ) {
+        this->shown.reset();
+        this->applied = generation;
+        this->cursor = this->top = 0;
+        return;
+    }
+
+    std::unique_ptr< Job > next( new Job );
+    next->generation = generation;
+    next->epoch = this->epoch;
+    next->rows = this->size();
+    next->depth = this->depth;
+    next->items = this->items;
+    for( char c : this->query_ ) next->query.push_back( fold( c ) );
+
+    {
+        std::lock_guard< std::mutex > guard( this->lock );
+        this->job = std::move( next );
+
+        if( !this->worker.joinable() ) {
+            this->worker = std::thread( &Selector::work, this );
+
+            const unsigned cores = this->threads_
+                ? this->threads_
+                : std::thread::hardware_concurrency();
+
+            for( unsigned i = 1; i < cores; ++i )
+                this->helpers.emplace_back( &Selector::help, this );
+        }
+    }
+
+    this->wake.notify_one();
+}
+
+/*
+ * Runs one search at a time, alongside the helpers. A query containing an
+ * earlier one only needs that one's matches looked at again, plus the items
+ * added since; of the recent results that qualify, the one that leaves the
+ * fewest candidates is used.
+ */
+void cursesxx::Selector::work() {
+    while( true ) {
+        std::unique_ptr< Job > job;
+
+        {
+            std::unique_lock< std::mutex > guard( this->lock );
+            this->wake.wait( guard, [this] {
+                return this->stopping || this->job;
+            } );
+
+            if( this->stopping ) return;
+            job = std::move( this->job );
+        }
+
+        const Result* base = nullptr;
+        std::size_t total = job->rows;
+
+        for( const auto& result : this->recent ) {
+            if( result->epoch != job->epoch || result->rows > job->rows
+                    || !subsequence( result->query, job->query ) )
+                continue;
+
+            const std::size_t candidates =
+                result->matches.size() + job->rows - result->rows;
+
+            if( candidates < total ) {
+                base = result.get();
+                total = candidates;
+            }
+        }
+
+        Search search;
+        search.generation = job->generation;
+        search.items = job->items;
+        search.query = job->query;
+        search.mask = signature( job->query.data(), job->query.size() );
+        search.depth = job->depth;
+        search.base = base ? &base->matches : nullptr;
+        search.from = base ? base->rows : 0;
+        search.total = total;
+        search.chunks = ( total + chunk_size - 1 ) / chunk_size;
+        search.found.resize( search.chunks );
+
+        {
+            std::lock_guard< std::mutex > guard( this->lock );
+            search.active = this->helpers.size();
+            this->current = &search;
+            ++this->round;
+        }
+
+        this->start.notify_all();
+        this->scan( search );
+
+        {
+            std::unique_lock< std::mutex > guard( this->lock );
+            this->finished.wait( guard, [&search] {
+                return search.active == 0;
+            } );
+            this->current = nullptr;
+        }
+
+        if( search.generation != this->requested ) continue;
+
+        std::shared_ptr< Result > result = std::make_shared< Result >();
+        result->query = std::move( job->query );
+        result->epoch = job->epoch;
+        result->rows = job->rows;
+
+        std::size_t matches = 0;
+        for( const Order& found : search.found ) matches += found.size();
+        result->matches.reserve( matches );
+        for( const Order& found : search.found )
+            result->matches.insert( result->matches.end(),
+                    found.begin(), found.end() );
+
+        std::sort( search.best.begin(), search.best.end(), better );
+        if( search.best.size() > search.depth )
+            search.best.resize( search.depth );
+
+        result->best.reserve( search.best.size() );
+        for( const Hit& hit : search.best ) result->best.push_back( hit.item );
+
+        /* results of other items, after a clear(), are of no use any more */
+        const unsigned long epoch = result->epoch;
+        this->recent.erase( std::remove_if( this->recent.begin(),
+                    this->recent.end(),
+                    [epoch]( const std::shared_ptr< const Result >& r ) {
+                        return r->epoch != epoch;
+                    } ), this->recent.end() );
+
+        if( this->recent.size() == 8 ) this->recent.erase( this->recent.begin() );
+        this->recent.push_back( result );
+
+        std::shared_ptr< Done > done = std::make_shared< Done >();
+        done->generation = search.generation;
+        done->result = std::move( result );
+        std::atomic_store( &this->done, done );
+
+        Channel* channel = this->channel.load();
+        if( channel ) channel->post( this, [this] { this->redraw(); } );
+    }
+}
+
+/*
+ * Helpers take part in every search. They only stop between searches, so
+ * the worker never waits on one that is gone.
+ */
+void cursesxx::Selector::help() {
+    unsigned long seen = 0;
+
+    while( true ) {
+        Search* search;
+
+        {
+            std::unique_lock< std::mutex > guard( this->lock );
+            this->start.wait( guard, [this, seen] {
+                return this->stopping || this->round != seen;
+            } );
+
+            if( this->round == seen ) return;
+            seen = this->round;
+            search = this->current;
+        }
+
+        this->scan( *search );
+
+        std::lock_guard< std::mutex > guard( this->lock );
+        if( --search->active == 0 ) this->finished.notify_one();
+    }
+}
+
+/*
+ * Takes chunks of the candidates until there are none left or the search
+ * is cancelled. The thread's best matches are kept in a heap with the worst
+ * on top, so a match that does not make it costs one comparison.
+ */
+void cursesxx::Selector::scan( Search& search ) {
+    const Items& items = *search.items;
+    const std::size_t based = search.base ? search.base->size() : 0;
+
+    std::vector< Hit > best;
+    best.reserve( search.depth );
+
+    while( search.generation == this->requested.load( std::memory_order_relaxed ) ) {
+        const std::size_t chunk = search.next++;
+        if( chunk >= search.chunks ) break;
+
+        const std::size_t end = std::min( ( chunk + 1 ) * chunk_size,
+                search.total );
+        Order& found = search.found[ chunk ];
+
+        for( std::size_t i = chunk * chunk_size; i < end; ++i ) {
+            const std::uint32_t item = i < based
+                ? ( *search.base )[ i ]
+                : search.from + ( i - based );
+
+            if( search.mask & ~items.masks[ item ] ) continue;
+
+            const std::size_t start = items.starts[ item ];
+            const std::size_t len = items.starts[ item + 1 ] - start;
+
+            int score;
+            if( !fuzzy( items.text.data() + start, len, search.query, score ) )
+                continue;
+
+            found.push_back( item );
+
+            const Hit hit = { score, std::uint32_t( len ), item };
+            if( best.size() < search.depth ) {
+                best.push_back( hit );
+                std::push_heap( best.begin(), best.end(), better );
+            } else if( better( hit, best.front() ) ) {
+                std::pop_heap( best.begin(), best.end(), better );
+                best.back() = hit;
+                std::push_heap( best.begin(), best.end(), better );
+            }
+        }
+    }
+
+    std::lock_guard< std::mutex > guard( search.lock );
+    search.best.insert( search.best.end(), best.begin(), best.end() );
+}
+
+/*
+ * Swaps in the worker's result, unless a newer one has been asked for
+ * since. A result for the query already shown only goes deeper, so the
+ * cursor stays where it is.
+ */
+void cursesxx::Selector::adopt() {
+    std::shared_ptr< Done > done =
+        std::atomic_exchange( &this->done, std::shared_ptr< Done >() );
+
+    if( !done || done->generation != this->requested ) return;
+
+    if( !this->shown || this->shown->query != done->result->query )
+        this->cursor = this->top = 0;
+
+    this->shown = std::move( done->result );
+    this->applied = done->generation;
+    this->stale = true;
+}
+
+/*
+ * Moves the cursor, and the view with it. Close to the end of the best
+ * matches kept, more of them are asked for.
+ */
+void cursesxx::Selector::move( std::ptrdiff_t delta ) {
+    const std::size_t listed = this->listed();
+    if( listed == 0 ) return;
+
+    std::size_t cursor = this->cursor;
+    if( delta < 0 ) cursor -= std::min< std::size_t >( cursor, -delta );
+    else            cursor = std::min< std::size_t >( cursor + delta, listed - 1 );
+
+    const std::size_t page = this->page();
+    if( cursor < this->top ) this->top = cursor;
+    if( cursor >= this->top + page ) this->top = cursor - page + 1;
+
+    this->cursor = cursor;
+    this->stale = true;
+
+    if( this->shown && cursor + page >= listed
+            && listed < this->shown->matches.size()
+            && !this->busy() && whole( this->query_ ) )
+        this->schedule( 2 * ( cursor + page ) );
+}
+
+/* Rows below the query */
+std::size_t cursesxx::Selector::page() const {
+    return std::max( this->widget.height() - 1, 1 );
+}
+
+/* The prompt and query, with the number of matches on the right */
+void cursesxx::Selector::draw_status() {
+    const std::size_t edge = std::max( this->widget.width(), 0 );
+
+    char count[ 48 ];
+    const std::size_t counted = std::snprintf( count, sizeof( count ),
+            " %zu/%zu", this->matched(), this->size() );
+
+    this->line.assign( this->prompt ).append( this->query_ );
+    std::size_t cols = edge > counted ? edge - counted : edge;
+    this->line.resize( fit( this->line.data(), this->line.size(), cols ) );
+
+    if( edge > counted ) {
+        this->line.append( edge - counted - cols, ' ' ).append( count );
+        cols = edge;
+    }
+
+    if( this->line == this->status ) return;
+
+    this->status = this->line;
+    this->widget.write( this->line.data(), this->line.size(), 0, 0 );
+    this->widget.clear_line( 0, cols );
+}
+
+void cursesxx::Selector::draw( int y, std::size_t item, bool selected ) {
+    if( item == none ) {
+        this->widget.clear_line( y );
+        return;
+    }
+
+    const std::size_t edge = std::max( this->widget.width(), 0 );
+    const Text text = this->items->at( item );
+    std::size_t cols = edge;
+    const std::size_t len = fit( text.data(), text.size(), cols );
+
+    if( !selected ) {
+        this->widget.write( text.data(), len, y, 0 );
+        this->widget.clear_line( y, cols );
+        return;
+    }
+
+    this->line.assign( text.data(), len ).append( edge - cols, ' ' );
+    Format reverse( this->widget, A_REVERSE );
+    this->widget.write( this->line.data(), this->line.size(), y, 0 );
+}
+
+/*
+ * Draws the rows whose item changed, or that were or now are the one
+ * selected; all of them if all is set.
+ */
+void cursesxx::Selector::paint( bool all ) {
+    if( all ) this->status.clear();
+    this->draw_status();
+
+    const int height = this->widget.height();
+    this->drawn.resize( std::max( height, 0 ), none );
+
+    const std::size_t listed = this->listed();
+    int lit = -1;
+
+    for( int y = 1; y < height; ++y ) {
+        const std::size_t position = this->top + y - 1;
+        const std::size_t item =
+            position < listed ? this->item_at( position ) : none;
+        const bool selected = item != none && position == this->cursor;
+        if( selected ) lit = y;
+
+        if( !all && this->drawn[ y ] == item && ( this->lit == y ) == selected )
+            continue;
+
+        this->draw( y, item, selected );
+        this->drawn[ y ] = item;
+    }
+
+    this->lit = lit;
+    this->stale = false;
+}
+
+void cursesxx::Selector::write() {
+    this->paint( true );
+}
+
+/* Only rewrites what changed, after swapping in a finished search */
+void cursesxx::Selector::redraw() {
+    this->adopt();
+    if( this->stale ) this->paint( false );
+    this->widget.redraw();
+}
+
+void cursesxx::Selector::decorate( const cursesxx::BorderStyle& b ) {
+    this->widget.decorate( b );
+    this->write();
+}
+
+void cursesxx::Selector::place( int y, int x, int height, int width ) {
+    this->widget.place( y, x, height, width );
+    this->move( 0 );
+    this->write();
+}
+
+const cursesxx::Widget& cursesxx::Selector::get_widget() const {
+    return this->widget;
+}
+
+/*
+ * LABEL
+ */
+cursesxx::Label::Label( std::string text ) :
+    widget( std::move( text ) )
+{}
+
+void cursesxx::Label::redraw() {
+    this->widget.write();
+    this->widget.redraw();
+}
+
+void cursesxx::Label::place( int y, int x, int height, int width ) {
+    this->widget.place( y, x, height, width );
+}
+
+const cursesxx::Widget& cursesxx::Label::get_widget() const {
+    return this->widget.get_widget();
+}
+
+/*
+ * DIALOG
+ */
+cursesxx::Dialog::Dialog( const Geometry& g, std::string message ) :
+    frame( g, mid( g ), BorderStyle() ),
+    message( this->frame, std::move( message ), g )
+{
+    this->message.redraw();
+}
+
+cursesxx::Dialog::Dialog( const Geometry& g, std::string message,
+        const BorderStyle& b ) :
+    frame( g, mid( g ), b ),
+    message( this->frame, std::move( message ), g )
+{
+    this->message.redraw();
+}
+
+void cursesxx::Dialog::write( const Text& text ) {
+    this->message.write( text );
+}
+
+/* a panel shown again goes on top, whatever was raised since */
+void cursesxx::Dialog::show() {
+    this->frame.show();
+}
+
+void cursesxx::Dialog::hide() {
+    this->frame.hide();
+}
+
+bool cursesxx::Dialog::hidden() const {
+    return this->frame.hidden();
+}
+
+void cursesxx::Dialog::redraw() {
+    this->message.redraw();
+}
+
+const cursesxx::Widget& cursesxx::Dialog::get_widget() const {
+    return this->message.get_widget();
+}
+
+/*
+ * LAYOUT
+ */
+
+cursesxx::Constraint::Constraint( int weight, int min, int max ) :
+    weight( std::max( weight, 0 ) ),
+    min( std::max( min, 0 ) ),
+    max( std::max( max, min ) )
+{}
+
+cursesxx::Layout::Item::Item( const Constraint& constraint ) :
+    constraint( constraint ),
+    y( -1 ), x( -1 ), height( -1 ), width( -1 )
+{}
+
+cursesxx::Layout::Layout( Kind kind, int columns ) :
+    kind( kind ),
+    columns( std::max( columns, 1 ) ),
+    height( LINES ),
+    width( COLS )
+{}
+
+/*
+ * Flags this layout for arranging, and every layout it is nested in for a
+ * visit on the next update.
+ */
+void cursesxx::Layout::mark() {
+    this->dirty = true;
+
+    for( Layout* p = this->parent; p && !p->pending; p = p->parent )
+        p->pending = true;
+}
+
+cursesxx::Layout& cursesxx::Layout::nest( Kind kind,
+        const Constraint& constraint, int columns ) {
+
+    Item entry( constraint );
+    entry.nested.reset( new Layout( kind, columns ) );
+    entry.nested->parent = this;
+    entry.nested->slot = this->items.size();
+
+    this->items.push_back( std::move( entry ) );
+    this->mark();
+    return *this->items.back().nested;
+}
+
+void cursesxx::Layout::constrain( std::size_t item,
+        const Constraint& constraint ) {
+
+    if( item >= this->items.size() ) return;
+
+    this->items[ item ].constraint = constraint;
+    this->mark();
+}
+
+/* Constrains a nested layout within the layout it is nested in */
+void cursesxx::Layout::constrain( const Constraint& constraint ) {
+    if( this->parent ) this->parent->constrain( this->slot, constraint );
+}
+
+void cursesxx::Layout::padding( int cells ) {
+    if( cells == this->padding_ ) return;
+
+    this->padding_ = std::max( cells, 0 );
+    this->mark();
+}
+
+void cursesxx::Layout::place( int y, int x, int height, int width ) {
+    if( y == this->y && x == this->x
+            && height == this->height && width == this->width )
+        return;
+
+    this->y = y;
+    this->x = x;
+    this->height = height;
+    this->width = width;
+    this->mark();
+}
+
+void cursesxx::Layout::update() {
+    if( this->dirty ) this->arrange();
+
+    if( this->dirty || this->pending ) {
+        for( Item& item : this->items )
+            if( item.nested && ( item.nested->dirty || item.nested->pending ) )
+                item.nested->update();
+    }
+
+    this->dirty = false;
+    this->pending = false;
+}
+
+/*
+ * Splits space between n tracks in one pass. Every track gets its minimum
+ * and a share of what is left proportional to its weight, up to its
+ * maximum; whatever a track cannot take stays with the tracks after it.
+ */
+template< typename F >
+static void distribute( int space, std::size_t n, F constraint,
+        std::vector< int >& sizes ) {
+
+    long weights = 0;
+    long mins = 0;
+    for( std::size_t i = 0; i < n; ++i ) {
+        weights += constraint( i ).weight;
+        mins += constraint( i ).min;
+    }
+
+    long extra = std::max< long >( space - mins, 0 );
+    long left = space;
+    sizes.resize( n );
+
+    for( std::size_t i = 0; i < n; ++i ) {
+        const cursesxx::Constraint& c = constraint( i );
+        const long share = weights > 0 ? extra * c.weight / weights : 0;
+        const long size = std::min< long >( c.min + share, c.max );
+
+        sizes[ i ] = std::max< long >( std::min( size, left ), 0 );
+        extra -= std::max< long >( size - c.min, 0 );
+        weights -= c.weight;
+        left -= sizes[ i ];
+    }
+}
+
+void cursesxx::Layout::assign( Item& item,
+        int y, int x, int height, int width ) {
+
+    if( y == item.y && x == item.x
+            && height == item.height && width == item.width )
+        return;
+
+    item.y = y;
+    item.x = x;
+    item.height = height;
+    item.width = width;
+
+    if( item.nested ) item.nested->place( y, x, height, width );
+    else if( height > 0 && width > 0 ) item.place( y, x, height, width );
+}
+
+void cursesxx::Layout::arrange() {
+    const int pad = this->padding_;
+    const int top = this->y + pad;
+    const int left = this->x + pad;
+    const int height = std::max( this->height - 2 * pad, 0 );
+    const int width = std::max( this->width - 2 * pad, 0 );
+
+    const std::size_t n = this->items.size();
+    if( n == 0 ) return;
+
+    std::vector< int > sizes;
+    const auto& items = this->items;
+
+    if( this->kind == row || this->kind == column ) {
+        const bool across = this->kind == row;
+
+        distribute( across ? width : height, n,
+                [&]( std::size_t i ) -> const Constraint& {
+                    return items[ i ].constraint;
+                }, sizes );
+
+        int offset = across ? left : top;
+        for( std::size_t i = 0; i < n; ++i ) {
+            if( across )
+                this->assign( this->items[ i ], top, offset, height, sizes[ i ] );
+            else
+                this->assign( this->items[ i ], offset, left, sizes[ i ], width );
+
+            offset += sizes[ i ];
+        }
+
+        return;
+    }
+
+    const std::size_t cols = std::min< std::size_t >( this->columns, n );
+    const std::size_t rows = ( n + cols - 1 ) / cols;
+
+    std::vector< int > widths;
+    distribute( width, cols, [&]( std::size_t i ) -> const Constraint& {
+            return items[ i ].constraint;
+        }, widths );
+
+    distribute( height, rows, [&]( std::size_t i ) -> const Constraint& {
+            return items[ i * cols ].constraint;
+        }, sizes );
+
+    int y = top;
+    for( std::size_t r = 0; r < rows; ++r ) {
+        int x = left;
+        for( std::size_t c = 0; c < cols && r * cols + c < n; ++c ) {
+            this->assign( this->items[ r * cols + c ],
+                    y, x, sizes[ r ], widths[ c ] );
+            x += widths[ c ];
+        }
+
+        y += sizes[ r ];
+    }
+}
+
+/*
+ * SPATIAL INDEX
+ */
+
+const cursesxx::SpatialIndex::Id cursesxx::SpatialIndex::none =
+    std::numeric_limits< Id >::max();
+
+cursesxx::SpatialIndex::SpatialIndex( int cell ) :
+    cell( std::max( cell, 1 ) )
+{}
+
+std::vector< cursesxx::SpatialIndex::Id >* cursesxx::SpatialIndex::bucket(
+        int row, int col ) {
+
+    if( row < 0 || row >= this->rows || col < 0 || col >= this->cols )
+        return nullptr;
+
+    return &this->buckets[ row * this->cols + col ];
+}
+
+/*
+ * Grows the grid to cover the entry. Everything is bucketed again, which
+ * only happens when something lands further out than anything before.
+ */
+void cursesxx::SpatialIndex::fit( const Entry& e ) {
+    const int rows = std::max( this->rows,
+            ( e.y + e.height - 1 ) / this->cell + 1 );
+    const int cols = std::max( this->cols,
+            ( e.x + e.width - 1 ) / this->cell + 1 );
+
+    if( rows == this->rows && cols == this->cols ) return;
+
+    this->rows = rows;
+    this->cols = cols;
+    this->buckets.assign( rows * cols, std::vector< Id >() );
+
+    for( Id id = 0; id < this->entries.size(); ++id )
+        if( this->entries[ id ].live && &this->entries[ id ] != &e )
+            this->insert( id );
+}
+
+void cursesxx::SpatialIndex::insert( Id id ) {
+    const Entry& e = this->entries[ id ];
+    if( e.height <= 0 || e.width <= 0 ) return;
+
+    for( int r = std::max( e.y, 0 ) / this->cell;
+            r <= ( e.y + e.height - 1 ) / this->cell; ++r )
+        for( int c = std::max( e.x, 0 ) / this->cell;
+                c <= ( e.x + e.width - 1 ) / this->cell; ++c )
+            if( auto* b = this->bucket( r, c ) ) b->push_back( id );
+}
+
+void cursesxx::SpatialIndex::erase( Id id ) {
+    const Entry& e = this->entries[ id ];
+    if( e.height <= 0 || e.width <= 0 ) return;
+
+    for( int r = std::max( e.y, 0 ) / this->cell;
+            r <= ( e.y + e.height - 1 ) / this->cell; ++r ) {
+        for( int c = std::max( e.x, 0 ) / this->cell;
+                c <= ( e.x + e.width - 1 ) / this->cell; ++c ) {
+            auto* b = this->bucket( r, c );
+            if( !b ) continue;
+
+            auto pos = std::find( b->begin(), b->end(), id );
+            if( pos == b->end() ) continue;
+
+            *pos = b->back();
+            b->pop_back();
+        }
+    }
+}
+
+cursesxx::SpatialIndex::Id cursesxx::SpatialIndex::add(
+        int y, int x, int height, int width,
+        Click click, std::function< void( bool ) > focus ) {
+
+    const Id id = this->entries.size();
+    this->entries.push_back( Entry{ y, x, height, width,
+            std::move( click ), std::move( focus ), true } );
+
+    this->fit( this->entries.back() );
+    this->insert( id );
+    return id;
+}
+
+void cursesxx::SpatialIndex::move( Id id,
+        int y, int x, int height, int width ) {
+
+    if( id >= this->entries.size() || !this->entries[ id ].live ) return;
+
+    Entry& e = this->entries[ id ];
+    if( e.y == y && e.x == x && e.height == height && e.width == width )
+        return;
+
+    this->erase( id );
+    e.y = y;
+    e.x = x;
+    e.height = height;
+    e.width = width;
+
+    this->fit( e );
+    this->insert( id );
+}
+
+void cursesxx::SpatialIndex::remove( Id id ) {
+    if( id >= this->entries.size() || !this->entries[ id ].live ) return;
+
+    this->erase( id );
+    this->entries[ id ].live = false;
+    this->entries[ id ].click = nullptr;
+    this->entries[ id ].focus = nullptr;
+    if( this->current == id ) this->current = none;
+}
+
+/* The entry on top at (y, x), or none */
+cursesxx::SpatialIndex::Id cursesxx::SpatialIndex::at( int y, int x ) const {
+    if( y < 0 || x < 0 ) return none;
+
+    const int row = y / this->cell;
+    const int col = x / this->cell;
+    if( row >= this->rows || col >= this->cols ) return none;
+
+    Id top = none;
+    for( const Id id : this->buckets[ row * this->cols + col ] ) {
+        const Entry& e = this->entries[ id ];
+        const bool inside = y >= e.y && y < e.y + e.height
+            && x >= e.x && x < e.x + e.width;
+
+        if( inside && ( top == none || id > top ) ) top = id;
+    }
+
+    return top;
+}
+
+/*
+ * Sends the event to the entry under it, focusing it first if it takes
+ * focus. Returns whether there was an entry to send it to.
+ */
+bool cursesxx::SpatialIndex::click( const MEVENT& event ) {
+    const Id id = this->at( event.y, event.x );
+    if( id == none ) return false;
+
+    if( this->entries[ id ].focus ) this->focus( id );
+
+    /* copy, the handler may remove its own entry */
+    Click handler = this->entries[ id ].click;
+    if( handler ) handler( event );
+    return true;
+}
+
+cursesxx::SpatialIndex::Id cursesxx::SpatialIndex::focused() const {
+    return this->current;
+}
+
+void cursesxx::SpatialIndex::focus( Id id ) {
+    if( id == this->current ) return;
+    if( id != none
+            && ( id >= this->entries.size() || !this->entries[ id ].focus ) )
+        return;
+
+    if( this->current != none ) this->entries[ this->current ].focus( false );
+    this->current = id;
+    if( id != none ) this->entries[ id ].focus( true );
+}
+
+/*
+ * Candidates lie ahead in the key's direction and are scored by the
+ * distance between centres along it plus twice the distance across it.
+ * Anything first met past ring r is more than r * cell cells away along
+ * one of the axes, so once the best score is within that, the search is
+ * over.
+ */
+bool cursesxx::SpatialIndex::navigate( int key ) {
+    int dy = 0, dx = 0;
+    switch( key ) {
+        case KEY_UP:    dy = -1; break;
+        case KEY_DOWN:  dy = 1;  break;
+        case KEY_LEFT:  dx = -1; break;
+        case KEY_RIGHT: dx = 1;  break;
+        default: return false;
+    }
+
+    if( this->current == none ) {
+        for( Id id = 0; id < this->entries.size(); ++id ) {
+            if( !this->entries[ id ].focus ) continue;
+            this->focus( id );
+            return true;
+        }
+
+        return false;
+    }
+
+    const Entry& from = this->entries[ this->current ];
+    const int cy = from.y + from.height / 2;
+    const int cx = from.x + from.width / 2;
+    const int row = std::max( cy, 0 ) / this->cell;
+    const int col = std::max( cx, 0 ) / this->cell;
+
+    Id best = none;
+    long best_score = 0;
+
+    const int rings = std::max( this->rows, this->cols );
+    for( int r = 0; r <= rings; ++r ) {
+        for( int br = row - r; br <= row + r; ++br ) {
+            for( int bc = col - r; bc <= col + r; ++bc ) {
+                /* only the ring itself, and only the half ahead */
+                if( std::max( std::abs( br - row ), std::abs( bc - col ) ) != r )
+                    continue;
+                if( ( br - row ) * dy < 0 || ( bc - col ) * dx < 0 ) continue;
+
+                const auto* b = this->bucket( br, bc );
+                if( !b ) continue;
+
+                for( const Id id : *b ) {
+                    const Entry& e = this->entries[ id ];
+                    if( id == this->current || !e.focus ) continue;
+
+                    const int ey = e.y + e.height / 2;
+                    const int ex = e.x + e.width / 2;
+                    const long ahead = long( ey - cy ) * dy + long( ex - cx ) * dx;
+                    const long across = dy ? std::abs( ex - cx )
+                                           : std::abs( ey - cy );
+
+                    if( ahead <= 0 ) continue;
+
+                    const long score = ahead + 2 * across;
+                    if( best == none || score < best_score
+                            || ( score == best_score && id < best ) ) {
+                        best = id;
+                        best_score = score;
+                    }
+                }
+            }
+        }
+
+        if( best != none && best_score <= long( r ) * this->cell ) break;
+    }
+
+    if( best == none ) return false;
+
+    this->focus( best );
+    return true;
+}
+
+/*
+ * RENDERER
+ */
+
+cursesxx::Renderer::Renderer( int fd ) : fd( fd )
+{}
+
+/* The next present() clears the terminal and sends every cell */
+void cursesxx::Renderer::invalidate() {
+    this->height = 0;
+    this->width = 0;
+}
+
+/* Whether two cells of the virtual screen look the same */
+static bool same( const cchar_t& a, const cchar_t& b ) {
+    if( a.attr != b.attr ) return false;
+#if NCURSES_EXT_COLORS
+    if( a.ext_color != b.ext_color ) return false;
+#endif
+
+    for( int i = 0; i < CCHARW_MAX; ++i ) {
+        if( a.chars[ i ] != b.chars[ i ] ) return false;
+        if( a.chars[ i ] == 0 ) break;
+    }
+
+    return true;
+}
+
+/* The colour pair of a cell, in full where it does not fit the attributes */
+static int pair_of( const cchar_t& c ) {
+#if NCURSES_EXT_COLORS
+    return c.ext_color;
+#else
+    return PAIR_NUMBER( c.attr );
+#endif
+}
+
+/* Attributes other than colour */
+static attr_t rendition_of( const cchar_t& c ) {
+    return c.attr & A_ATTRIBUTES & ~A_COLOR;
+}
+
+/* A cell as a chtype: its attributes, and its glyph if that is ASCII */
+static chtype narrow( const cchar_t& c ) {
+    const wchar_t glyph = c.chars[ 0 ];
+    return ( c.attr & A_ATTRIBUTES ) | ( glyph < 0x80 ? glyph : '?' );
+}
+
+static void encode( std::string& out, wchar_t c ) {
+    if( c < 0x80 ) {
+        out.push_back( c );
+    } else if( c < 0x800 ) {
+        out.push_back( 0xC0 | ( c >> 6 ) );
+        out.push_back( 0x80 | ( c & 0x3F ) );
+    } else if( c < 0x10000 ) {
+        out.push_back( 0xE0 | ( c >> 12 ) );
+        out.push_back( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+        out.push_back( 0x80 | ( c & 0x3F ) );
+    } else {
+        out.push_back( 0xF0 | ( c >> 18 ) );
+        out.push_back( 0x80 | ( ( c >> 12 ) & 0x3F ) );
+        out.push_back( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+        out.push_back( 0x80 | ( c & 0x3F ) );
+    }
+}
+
+/* The glyph of a cell, with any combining characters, as UTF-8 */
+static void glyph( std::string& out, const cchar_t& c ) {
+    for( int i = 0; i < CCHARW_MAX && c.chars[ i ]; ++i )
+        encode( out, c.chars[ i ] );
+}
+
+static cchar_t blank_cell() {
+    cchar_t c = cchar_t();
+    c.chars[ 0 ] = L' ';
+    return c;
+}
+
+chtype cursesxx::Renderer::cell( int y, int x ) const {
+    if( y < 0 || y >= this->height || x < 0 || x >= this->width ) return 0;
+    return narrow( this->front[ y * this->width + x ] );
+}
+
+int cursesxx::Renderer::pair( int y, int x ) const {
+    if( y < 0 || y >= this->height || x < 0 || x >= this->width ) return 0;
+    return pair_of( this->front[ y * this->width + x ] );
+}
+
+std::string cursesxx::Renderer::line( int y ) const {
+    std::string text;
+    if( y < 0 || y >= this->height ) return text;
+
+    /* a wide glyph covers the cells after it as well */
+    for( int x = 0; x < this->width; ) {
+        const cchar_t& c = this->front[ y * this->width + x ];
+        glyph( text, c );
+        x += std::max( glyph_width( c.chars[ 0 ] ), 1 );
+    }
+
+    return text;
+}
+
+/* Bytes sent to the terminal so far, or that would have been */
+std::size_t cursesxx::Renderer::written() const {
+    return this->written_;
+}
+
+/*
+ * A cursor move costs 4 to 8 bytes, so a short hop forward along the row is
+ * done by writing the unchanged cells in between again, when they already
+ * have the current rendition.
+ */
+void cursesxx::Renderer::move( int y, int x ) {
+    if( y == this->cy && x == this->cx ) return;
+
+    if( y == this->cy && this->cx >= 0 && x > this->cx && x - this->cx <= 4 ) {
+        const cchar_t* shown = &this->front[ y * this->width ];
+
+        bool plain = true;
+        for( int i = this->cx; i < x && plain; ++i )
+            plain = rendition_of( shown[ i ] ) == this->rendition
+                && pair_of( shown[ i ] ) == this->colours
+                && shown[ i ].chars[ 0 ] < 0x80 && !shown[ i ].chars[ 1 ];
+
+        if( plain ) {
+            for( int i = this->cx; i < x; ++i )
+                this->out.push_back( shown[ i ].chars[ 0 ] );
+
+            this->cx = x;
+            return;
+        }
+    }
+
+    char cup[ 32 ];
+    std::snprintf( cup, sizeof( cup ), "\x1b[%d;%dH", y + 1, x + 1 );
+    this->out += cup;
+    this->cy = y;
+    this->cx = x;
+}
+
+static void sgr_colour( std::string& out, int colour, int base ) {
+    char code[ 32 ];
+
+    if( colour < 0 ) return;
+    else if( colour < 8 )
+        std::snprintf( code, sizeof( code ), ";%d", base + colour );
+    else if( colour < 16 )
+        std::snprintf( code, sizeof( code ), ";%d", base + 60 + colour - 8 );
+    else
+        std::snprintf( code, sizeof( code ), ";%d;5;%d", base + 8, colour );
+
+    out += code;
+}
+
+/*
+ * Switches to a rendition and colour pair. The line drawing character set
+ * is switched on its own; everything else is set from scratch with one SGR.
+ */
+void cursesxx::Renderer::style( attr_t rendition, int pair ) {
+    const attr_t changed = rendition ^ this->rendition;
+    if( !changed && pair == this->colours ) return;
+
+    if( changed & A_ALTCHARSET )
+        this->out += rendition & A_ALTCHARSET ? "\x1b(0" : "\x1b(B";
+
+    if( ( changed & ~attr_t( A_ALTCHARSET ) ) || pair != this->colours ) {
+        this->out += "\x1b[0";
+        if( rendition & A_BOLD ) this->out += ";1";
+        if( rendition & A_DIM ) this->out += ";2";
+#ifdef A_ITALIC
+        if( rendition & A_ITALIC ) this->out += ";3";
+#endif
+        if( rendition & A_UNDERLINE ) this->out += ";4";
+        if( rendition & A_BLINK ) this->out += ";5";
+        if( rendition & ( A_REVERSE | A_STANDOUT ) ) this->out += ";7";
+        if( rendition & A_INVIS ) this->out += ";8";
+
+#if NCURSES_EXT_COLORS
+        int fg, bg;
+        if( pair > 0 && extended_pair_content( pair, &fg, &bg ) != ERR ) {
+#else
+        short fg, bg;
+        if( pair > 0 && pair_content( pair, &fg, &bg ) != ERR ) {
+#endif
+            sgr_colour( this->out, fg, 30 );
+            sgr_colour( this->out, bg, 40 );
+        }
+
+        this->out.push_back( 'm' );
+    }
+
+    this->rendition = rendition;
+    this->colours = pair;
+}
+
+void cursesxx::Renderer::flush() {
+    this->written_ += this->out.size();
+
+    const char* data = this->out.data();
+    std::size_t left = this->fd < 0 ? 0 : this->out.size();
+
+    while( left > 0 ) {
+        const ssize_t n = ::write( this->fd, data, left );
+        if( n < 0 && errno == EINTR ) continue;
+        if( n <= 0 ) break;
+
+        data += n;
+        left -= n;
+    }
+
+    this->out.clear();
+}
+
+/*
+ * Only rows curses marked as touched on the virtual screen are read; they
+ * are untouched again afterwards, as doupdate() would.
+ */
+void cursesxx::Renderer::present() {
+    const bool full = this->height != LINES || this->width != COLS;
+
+    if( full ) {
+        this->height = LINES;
+        this->width = COLS;
+        this->front.assign( this->height * this->width, blank_cell() );
+        this->back.assign( this->width + 1, blank_cell() );
+
+        this->out += "\x1b[0m\x1b(B\x1b[H\x1b[2J";
+        this->rendition = 0;
+        this->colours = 0;
+        this->cy = 0;
+        this->cx = 0;
+    }
+
+    int cursor_y, cursor_x;
+    getyx( newscr, cursor_y, cursor_x );
+
+    for( int y = 0; y < this->height; ++y ) {
+        if( !full && !is_linetouched( newscr, y ) ) continue;
+
+        /*
+         * The row is read a glyph per cell, up to a blank terminator; the
+         * front grid keeps a copy of a wide glyph in every column it covers.
+         */
+        const cchar_t* row = &this->back[ 0 ];
+        cchar_t* shown = &this->front[ y * this->width ];
+        mvwin_wchnstr( newscr, y, 0, &this->back[ 0 ], this->width );
+
+        for( int x = 0; x < this->width && row->chars[ 0 ]; ++row ) {
+            const wchar_t c = row->chars[ 0 ];
+            const int span = c < 0x80 ? 1 : std::max( glyph_width( c ), 1 );
+
+            if( !same( *row, shown[ x ] ) ) {
+                this->move( y, x );
+                this->style( rendition_of( *row ), pair_of( *row ) );
+                glyph( this->out, *row );
+
+                /* past the last column the cursor position is up to the terminal */
+                this->cx += span;
+                if( this->cx >= this->width ) this->cy = this->cx = -1;
+            }
+
+            for( const int end = std::min( x + span, this->width ); x < end; ++x )
+                shown[ x ] = *row;
+        }
+    }
+
+    wtouchln( newscr, 0, this->height, 0 );
+    wmove( newscr, cursor_y, cursor_x );
+    this->move( cursor_y, cursor_x );
+    this->flush();
+}
+
+/*
+ * CHANNEL
+ */
+
+cursesxx::Channel::Channel() :
+    head( &this->stub ),
+    tail( &this->stub ),
+    event( eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) ),
+    signalled( false ),
+    serials( 0 )
+{
+    if( this->event < 0 )
+        throw std::system_error( errno, std::system_category(), "eventfd" );
+
+    this->stub.next.store( nullptr, std::memory_order_relaxed );
+}
+
+cursesxx::Channel::~Channel() {
+    bool busy;
+    while( Node* node = this->pop( busy ) ) delete node;
+
+    close( this->event );
+}
+
+int cursesxx::Channel::fd() const {
+    return this->event;
+}
+
+/*
+ * The queue is Vyukov's intrusive MPSC queue: producers swing head to their
+ * node with one atomic exchange and then link the previous head to it; the
+ * consumer walks the links from tail. A producer preempted between those two
+ * steps leaves the queue briefly unlinked, which pop() reports as busy.
+ */
+void cursesxx::Channel::push( Node* node ) {
+    node->next.store( nullptr, std::memory_order_relaxed );
+    Node* prev = this->head.exchange( node, std::memory_order_acq_rel );
+    prev->next.store( node, std::memory_order_release );
+}
+
+cursesxx::Channel::Node* cursesxx::Channel::pop( bool& busy ) {
+    busy = false;
+
+    Node* tail = this->tail;
+    Node* next = tail->next.load( std::memory_order_acquire );
+
+    if( tail == &this->stub ) {
+        if( !next ) return nullptr;
+
+        this->tail = tail = next;
+        next = next->next.load( std::memory_order_acquire );
+    }
+
+    if( next ) {
+        this->tail = next;
+        return tail;
+    }
+
+    if( tail != this->head.load( std::memory_order_acquire ) ) {
+        busy = true;
+        return nullptr;
+    }
+
+    this->push( &this->stub );
+    next = tail->next.load( std::memory_order_acquire );
+
+    if( next ) {
+        this->tail = next;
+        return tail;
+    }
+
+    busy = true;
+    return nullptr;
+}
+
+/* Only the first post after a drain pays for the eventfd write */
+void cursesxx::Channel::signal() {
+    if( this->signalled.exchange( true, std::memory_order_acq_rel ) ) return;
+
+    const uint64_t one = 1;
+    ssize_t written = ::write( this->event, &one, sizeof( one ) );
+    (void)written;
+}
+
+void cursesxx::Channel::acknowledge() {
+    uint64_t count;
+    ssize_t got = read( this->event, &count, sizeof( count ) );
+    (void)got;
+}
+
+void cursesxx::Channel::post( std::function< void() > update ) {
+    this->post( nullptr, std::move( update ) );
+}
+
+void cursesxx::Channel::post( const void* key,
+        std::function< void() > update ) {
+
+    Node* node = new Node;
+    node->key = key;
+    node->serial = this->serials.fetch_add( 1, std::memory_order_relaxed );
+    node->update = std::move( update );
+
+    this->push( node );
+    this->signal();
+}
+
+void cursesxx::Channel::write( Textfield& field, const std::string& text ) {
+    this->post( &field, [&field, text] {
+        field.write( text );
+        field.redraw();
+    } );
+}
+
+void cursesxx::Channel::append( Textfield& field, const std::string& text ) {
+    this->post( [&field, text] {
+        field.append( text );
+        field.redraw();
+    } );
+}
+
+std::size_t cursesxx::Channel::drain() {
+    this->signalled.store( false, std::memory_order_release );
+    this->acknowledge();
+
+    bool busy;
+    while( Node* node = this->pop( busy ) )
+        this->batch.push_back( node );
+
+    /* a producer is mid-post; make sure the loop comes back for it */
+    if( busy ) this->signal();
+
+    /* walking backwards, the first node seen for a key is the one to keep */
+    for( auto node = this->batch.rbegin(); node != this->batch.rend(); ++node ) {
+        if( ( *node )->key && !this->seen.insert( ( *node )->key ).second )
+            ( *node )->update = nullptr;
+    }
+
+    if( !this->forgotten.empty() ) {
+        for( Node* node : this->batch ) {
+            auto gone = this->forgotten.find( node->key );
+            if( gone != this->forgotten.end() && node->serial < gone->second )
+                node->update = nullptr;
+        }
+
+        /* with the queue seen empty, every forgotten post has been dropped */
+        if( !busy ) this->forgotten.clear();
+    }
+
+    std::size_t applied = 0;
+    for( Node* node : this->batch ) {
+        if( node->update ) {
+            node->update();
+            ++applied;
+        }
+
+        delete node;
+    }
+
+    this->batch.clear();
+    this->seen.clear();
+    return applied;
+}
+
+/*
+ * Whoever forgets a key has stopped posting with it, so its posts all have
+ * serials below the current one; a new object at the same address posts
+ * with later serials, which are kept.
+ */
+void cursesxx::Channel::forget( const void* key ) {
+    if( !key ) return;
+    this->forgotten[ key ] =
+        this->serials.load( std::memory_order_relaxed );
+}
+
+/* Colours are set up as soon as curses is, so Color works right away */
+static void start_colors() {
+    if( has_colors() ) {
+        start_color();
+        use_default_colors();
+    }
+
+    pairs.reset();
+}
+
+/*
+ * curses decodes and measures text by the locale, so unless the program
+ * chose one the environment's is used, as a UTF-8 terminal needs.
+ */
+static void use_locale() {
+    const char* current = std::setlocale( LC_CTYPE, nullptr );
+    if( current && std::strcmp( current, "C" ) == 0 )
+        std::setlocale( LC_CTYPE, "" );
+}
+
+static SCREEN* open_terminal( const char* term, FILE* out, FILE* in ) {
+    use_locale();
+    return newterm( term, out, in );
+}
+
+cursesxx::Application::Screen::Screen() : term( nullptr ) {
+    use_locale();
+    initscr();
+    start_colors();
+}
+
+cursesxx::Application::Screen::Screen( FILE* out, FILE* in,
+        const char* term ) :
+    term( open_terminal( term, out, in ) )
+{
+    if( !this->term )
+        throw std::runtime_error( "curses++: cannot initialize terminal" );
+
+    start_colors();
+}
+
+cursesxx::Application::Screen::~Screen() {
+    endwin();
+    if( this->term ) delscreen( this->term );
+}
+
+cursesxx::Application::Application() :
+    input( STDIN_FILENO ),
+    poller( epoll_create1( EPOLL_CLOEXEC ) ),
+    interval( std::chrono::seconds( 1 ) / 60 )
+{
+    this->listen();
+    frame_depths.push_back( &this->frame_depth );
+}
+
+cursesxx::Application::Application( FILE* out, FILE* in, const char* term ) :
+    screen( out, in, term ),
+    input( fileno( in ) ),
+    poller( epoll_create1( EPOLL_CLOEXEC ) ),
+    interval( std::chrono::seconds( 1 ) / 60 )
+{
+    this->listen();
+    frame_depths.push_back( &this->frame_depth );
+}
+
+void cursesxx::Application::listen() {
+    if( this->poller < 0 )
+        throw std::system_error( errno, std::system_category(), "epoll" );
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = this->input;
+    epoll_ctl( this->poller, EPOLL_CTL_ADD, this->input, &ev );
+}
+
+/*
+ * Spawned tasks still waiting are destroyed first, while the screen and
+ * their widgets are still there. Destroying a task destroys the tasks it
+ * is awaiting, which unregister whatever they were waiting for.
+ */
+cursesxx::Application::~Application() {
+    auto tasks = std::move( this->tasks );
+    for( auto& task : tasks ) task.second( task.first );
+
+    frame_depths.erase( std::find( frame_depths.begin(), frame_depths.end(),
+                &this->frame_depth ) );
+
+    close( this->poller );
+}
+
+cursesxx::Application& cursesxx::Application::keypad( const bool enable ) {
+    ::keypad( stdscr, enable );
+    return *this;
+}
+
+cursesxx::Application& cursesxx::Application::echo( const bool enable ) {
+    enable ? ::echo() : noecho();
+    return *this;
+}
+
+cursesxx::Application& cursesxx::Application::cursor( const bool enable ) {
+    curs_set( enable ? 1 : 0 );
+    return *this;
+}
+
+cursesxx::Application& cursesxx::Application::begin_frame() {
+#ifdef CURSESXX_STATS
+    if( this->frame_depth == 0 ) {
+        frame_start = std::chrono::steady_clock::now();
+        frame_totals = totals;
+    }
+#endif
+
+    ++this->frame_depth;
+    return *this;
+}
+
+cursesxx::Application& cursesxx::Application::commit() {
+    if( this->frame_depth == 0 ) return *this;
+    if( --this->frame_depth > 0 ) return *this;
+
+    if( restacked ) update_panels();
+    restacked = false;
+
+    if( backend ) backend->present();
+    else doupdate();
+
+#ifdef CURSESXX_STATS
+    const auto us = std::chrono::duration_cast< std::chrono::microseconds >(
+            std::chrono::steady_clock::now() - frame_start ).count();
+
+    std::size_t bucket = 0;
+    while( ( 2ull << bucket ) <= std::uint64_t( us )
+            && bucket + 1 < frame_times.size() )
+        ++bucket;
+
+    ++frame_times[ bucket ];
+    ++frames;
+    last_frame = totals - frame_totals;
+#endif
+
+    return *this;
+}
+
+cursesxx::Application& cursesxx::Application::render( Renderer* renderer ) {
+    backend = renderer;
+
+    /* neither knows what the other sent, so start from a clean screen */
+    if( renderer ) renderer->invalidate();
+    else clearok( curscr, TRUE );
+
+    return *this;
+}
+
+cursesxx::Statistics cursesxx::Application::stats() const {
+    Statistics snapshot;
+
+#ifdef CURSESXX_STATS
+    snapshot.enabled = true;
+    snapshot.frames = frames;
+    snapshot.total = totals;
+    snapshot.last_frame = last_frame;
+    snapshot.frame_times = frame_times;
+
+    for( const Probe* probe : probes ) {
+        const Widget& widget = probe->widget();
+        const Anchor at = widget.position();
+
+        snapshot.widgets.push_back( Statistics::Entry{
+                at.y, at.x, widget.height(), widget.width(),
+                probe->counters() } );
+    }
+#endif
+
+    return snapshot;
+}
+
+cursesxx::Frame::Frame( Application& app ) : app( app ) {
+    this->app.begin_frame();
+}
+
+cursesxx::Frame::~Frame() {
+    this->app.commit();
+}
+
+cursesxx::Application& cursesxx::Application::on_key(
+        std::function< void( int ) > handler ) {
+    this->key_handler = std::move( handler );
+    return *this;
+}
+
+cursesxx::Application& cursesxx::Application::on_frame(
+        std::function< void() > handler ) {
+    this->frame_handler = std::move( handler );
+    return *this;
+}
+
+cursesxx::Application& cursesxx::Application::on_resize(
+        std::function< void() > handler ) {
+    this->resize_handler = std::move( handler );
+    return *this;
+}
+
+cursesxx::Application& cursesxx::Application::watch( int fd,
+        std::function< void( int ) > handler ) {
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+
+    const int op = this->watchers.count( fd ) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if( epoll_ctl( this->poller, op, fd, &ev ) < 0 )
+        throw std::system_error( errno, std::system_category(), "epoll_ctl" );
+
+    this->watchers[ fd ] = std::move( handler );
+    return *this;
+}
+
+cursesxx::Application& cursesxx::Application::unwatch( int fd ) {
+    if( this->watchers.erase( fd ) )
+        epoll_ctl( this->poller, EPOLL_CTL_DEL, fd, nullptr );
+
+    return *this;
+}
+
+cursesxx::Application& cursesxx::Application::fps( unsigned int rate ) {
+    if( rate == 0 )
+        this->interval = std::chrono::steady_clock::duration::zero();
+    else
+        this->interval = std::chrono::duration_cast<
+            std::chrono::steady_clock::duration >(
+                    std::chrono::seconds( 1 ) ) / rate;
+
+    return *this;
+}
+
+cursesxx::Application& cursesxx::Application::request_frame() {
+    this->frame_pending = true;
+    return *this;
+}
+
+void cursesxx::Application::quit() {
+    this->running = false;
+}
+
+/* Orders the deadline heap with the earliest (then oldest) on top */
+bool cursesxx::Application::Deadline::later( const Deadline& a,
+        const Deadline& b ) {
+    if( a.when != b.when ) return a.when > b.when;
+    return a.id > b.id;
+}
+
+cursesxx::Application::Wait cursesxx::Application::after(
+        std::chrono::milliseconds delay, std::function< void() > f ) {
+
+    const Wait id = ++this->waits;
+    this->deadlines.push_back(
+            Deadline{ std::chrono::steady_clock::now() + delay, id } );
+    std::push_heap( this->deadlines.begin(), this->deadlines.end(),
+            Deadline::later );
+    this->alarms.emplace( id, std::move( f ) );
+    return id;
+}
+
+cursesxx::Application::Wait cursesxx::Application::next_key(
+        std::function< void( int ) > f ) {
+
+    const Wait id = ++this->waits;
+    this->key_waits.emplace_back( id, std::move( f ) );
+    return id;
+}
+
+/*
+ * A timer leaves its deadline in the heap, to be dropped when it comes up.
+ * A key wait may be in the batch being handed a key right now, in which case
+ * it is skipped.
+ */
+void cursesxx::Application::cancel( Wait id ) {
+    if( this->alarms.erase( id ) ) return;
+
+    for( auto* waits : { &this->key_waits, &this->waking } ) {
+        for( auto wait = waits->begin(); wait != waits->end(); ++wait ) {
+            if( wait->first != id ) continue;
+
+            if( waits == &this->waking ) wait->second = nullptr;
+            else waits->erase( wait );
+            return;
+        }
+    }
+}
+
+/*
+ * Runs every timer due by now, set before this call. A timer set by one of
+ * them waits for the next call, even if its time has already come, so a
+ * task sleeping in a loop can never hold up the event loop.
+ */
+void cursesxx::Application::expire() {
+    const auto now = std::chrono::steady_clock::now();
+    const Wait last = this->waits;
+
+    while( !this->deadlines.empty() ) {
+        const Deadline first = this->deadlines.front();
+        if( first.when > now || first.id > last ) break;
+
+        std::pop_heap( this->deadlines.begin(), this->deadlines.end(),
+                Deadline::later );
+        this->deadlines.pop_back();
+
+        auto alarm = this->alarms.find( first.id );
+        if( alarm == this->alarms.end() ) continue;
+
+        std::function< void() > f = std::move( alarm->second );
+        this->alarms.erase( alarm );
+        f();
+        this->frame_pending = true;
+    }
+}
+
+/* Milliseconds until the first timer is due, rounded up, or -1 */
+int cursesxx::Application::until_due() {
+    while( !this->deadlines.empty()
+            && !this->alarms.count( this->deadlines.front().id ) ) {
+        std::pop_heap( this->deadlines.begin(), this->deadlines.end(),
+                Deadline::later );
+        this->deadlines.pop_back();
+    }
+
+    if( this->deadlines.empty() ) return -1;
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto when = this->deadlines.front().when;
+    if( when <= now ) return 0;
+
+    return 1 + std::chrono::duration_cast< std::chrono::milliseconds >(
+            when - now ).count();
+}
+
+void cursesxx::Application::adopt( void* frame, void (*destroy)( void* ) ) {
+    this->tasks.emplace( frame, destroy );
+}
+
+void cursesxx::Application::release( void* frame ) {
+    this->tasks.erase( frame );
+}
+
+void cursesxx::Application::fail( std::exception_ptr error ) {
+    if( !this->failure ) this->failure = std::move( error );
+}
+
+/*
+ * Drains every key curses has, buffered or not, so one wake-up handles a
+ * whole burst of input.
+ */
+void cursesxx::Application::read_keys() {
+    int key;
+    while( ( key = wgetch( stdscr ) ) != ERR ) {
+        /* curses has already resized stdscr and curscr by now */
+        if( key == KEY_RESIZE ) this->resized = true;
+
+        /* a key being waited for goes to the waiting tasks only */
+        if( key != KEY_RESIZE && !this->key_waits.empty() ) {
+            this->waking.swap( this->key_waits );
+            for( auto& wait : this->waking )
+                if( wait.second ) wait.second( key );
+
+            this->waking.clear();
+            this->frame_pending = true;
+            continue;
+        }
+
+        bool handled = false;
+        if( key == KEY_MOUSE ) {
+            MEVENT event;
+            if( getmouse( &event ) == OK )
+                for( SpatialIndex* index : this->indexes )
+                    if( ( handled = index->click( event ) ) ) break;
+        } else {
+            for( SpatialIndex* index : this->indexes )
+                if( ( handled = index->navigate( key ) ) ) break;
+        }
+
+        if( !handled && this->key_handler ) this->key_handler( key );
+        this->frame_pending = true;
+    }
+}
+
+cursesxx::Application& cursesxx::Application::attach( Channel& channel ) {
+    this->channels.push_back( &channel );
+
+    /* just wake up; the updates themselves are applied by the next frame */
+    return this->watch( channel.fd(),
+            [&channel]( int ) { channel.acknowledge(); } );
+}
+
+cursesxx::Application& cursesxx::Application::attach( Layout& layout ) {
+    layout.place( 0, 0, LINES, COLS );
+    this->layouts.push_back( &layout );
+    this->frame_pending = true;
+    return *this;
+}
+
+cursesxx::Application& cursesxx::Application::attach( SpatialIndex& index ) {
+    this->indexes.push_back( &index );
+    return *this;
+}
+
+/* Mouse events arrive as KEY_MOUSE, which needs the keypad enabled */
+cursesxx::Application& cursesxx::Application::mouse( const bool enable ) {
+    mousemask( enable ? ALL_MOUSE_EVENTS : 0, nullptr );
+    mouseinterval( 0 );
+    return *this;
+}
+
+/*
+ * Layouts are only given the new screen here; they move their widgets when
+ * updated at the end of the frame, after the handlers had their say.
+ */
+void cursesxx::Application::resize() {
+    this->resized = false;
+
+    for( Layout* layout : this->layouts )
+        layout->place( 0, 0, LINES, COLS );
+
+    if( this->resize_handler ) this->resize_handler();
+}
+
+void cursesxx::Application::frame() {
+    /* cleared first, so the handlers can ask for another frame */
+    this->frame_pending = false;
+
+    this->begin_frame();
+    if( this->resized ) this->resize();
+    for( Channel* channel : this->channels ) channel->drain();
+    if( this->frame_handler ) this->frame_handler();
+    for( Layout* layout : this->layouts ) layout->update();
+    this->commit();
+
+    this->next_frame = std::chrono::steady_clock::now() + this->interval;
+}
+
+void cursesxx::Application::run() {
+    using clock = std::chrono::steady_clock;
+
+    /* keys are read only when epoll says so; never block in wgetch */
+    nodelay( stdscr, TRUE );
+    untouchwin( stdscr );
+
+    this->running = true;
+    this->frame_pending = true;
+    this->next_frame = clock::now();
+
+    /*
+     * SIGWINCH is only let through while waiting, so a resize can never slip
+     * in between two waits and go unnoticed until the next key.
+     */
+    sigset_t winch, previous, waiting;
+    sigemptyset( &winch );
+    sigaddset( &winch, SIGWINCH );
+    pthread_sigmask( SIG_BLOCK, &winch, &previous );
+    waiting = previous;
+    sigdelset( &waiting, SIGWINCH );
+
+    const int max_events = 32;
+    epoll_event events[ max_events ];
+
+    while( this->running ) {
+        /* a spawned task failed; what was woken up with it has run by now */
+        if( this->failure ) {
+            std::exception_ptr failure = this->failure;
+            this->failure = nullptr;
+            this->running = false;
+            pthread_sigmask( SIG_SETMASK, &previous, nullptr );
+            std::rethrow_exception( failure );
+        }
+
+        /*
+         * sleep until something happens, or until the next frame or the
+         * first timer is due
+         */
+        int timeout = this->until_due();
+        if( this->frame_pending ) {
+            const auto now = clock::now();
+            const int frame = this->next_frame <= now ? 0 : 1 +
+                std::chrono::duration_cast< std::chrono::milliseconds >(
+                        this->next_frame - now ).count();
+            timeout = timeout < 0 ? frame : std::min( timeout, frame );
+        }
+
+        const int n = epoll_pwait( this->poller, events, max_events,
+                timeout, &waiting );
+
+        /* a signal, such as SIGWINCH, may have queued a key (KEY_RESIZE) */
+        if( n < 0 && errno == EINTR ) this->read_keys();
+
+        for( int i = 0; i < n && this->running; ++i ) {
+            const int fd = events[ i ].data.fd;
+
+            if( fd == this->input ) {
+                this->read_keys();
+                continue;
+            }
+
+            auto watcher = this->watchers.find( fd );
+            if( watcher == this->watchers.end() ) continue;
+
+            /* copy, the handler may unwatch itself */
+            auto handler = watcher->second;
+            handler( fd );
+            this->frame_pending = true;
+        }
+
+        if( this->running ) this->expire();
+
+        if( this->running && this->frame_pending
+                && clock::now() >= this->next_frame )
+            this->frame();
+    }
+
+    pthread_sigmask( SIG_SETMASK, &previous, nullptr );
 }
 
 int cursesxx::mid( int A, int B ) {
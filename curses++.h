@@ -1,36 +1,96 @@
 #ifndef CURSESXX_APPLICATION
 #define CURSESXX_APPLICATION
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <initializer_list>
+#include <map>
+#include <mutex>
 #include <vector>
 #include <string>
+#include <thread>
+#include <utility>
+#include <unordered_map>
+#include <unordered_set>
 #include <functional>
+#include <limits>
 #include <memory>
+/* the wide character API, for UTF-8 text; link with ncursesw */
+#ifndef NCURSES_WIDECHAR
+#define NCURSES_WIDECHAR 1
+#endif
 #include <ncurses.h>
+#include <panel.h>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+#if __cplusplus >= 202002L
+#include <coroutine>
+#include <optional>
+#include <type_traits>
+#endif
 
 namespace cursesxx {
 
     class Widget;
+    class Channel;
+
+    class Color;
 
     class Format {
         public:
             template< typename T >
                 Format( const T&, int bitmask );
+            template< typename T >
+                Format( const T&, const Color& fg );
+            template< typename T >
+                Format( const T&, const Color& fg, const Color& bg );
             ~Format();
 
         private:
             WINDOW* win;
             int bitmask;
 
+            /* the colour pair set, or -1, and the one it replaced */
+            int pair = -1;
+            int previous = 0;
+
+            void set_pair();
+
             static WINDOW* get_win( const Widget& );
             template< typename T > static WINDOW* get_win( const T& );
     };
 
+    /*
+     * A colour given as RGB, 0-255 per channel; a default constructed Color
+     * is the terminal's default colour. On screen it becomes the nearest
+     * colour the terminal has (one of the 256 xterm colours, or of the 16 or
+     * 8 basic ones), found through a precomputed table rather than a search.
+     *
+     * Foreground/background combinations get a curses colour pair from a
+     * cache that keeps recently used combinations, so recolouring only calls
+     * init_pair() for combinations not seen lately. When every pair is taken
+     * the least recently used one is recycled, which also recolours whatever
+     * is still on screen in it.
+     */
     class Color {
         public:
+            Color();
             Color( unsigned int R, unsigned int G, unsigned int B );
 
+            int index() const;
+
+            static int pair( const Color& fg, const Color& bg );
+
         private:
             unsigned int R, G, B;
+            bool terminal_default;
     };
 
     /*
@@ -46,13 +106,18 @@ namespace cursesxx {
             BorderStyle( char ls, char rs, char ts,
                     char bs, char tl, char tr, char bl, char br );
 
+            bool operator==( const BorderStyle& ) const;
+            bool operator!=( const BorderStyle& ) const;
+
             const bool detailed;
             const char ls, rs, ts, bs, tl, tr, bl, br;
     };
 
 
     /*
-     * Draws the border for a particular window
+     * Draws the border for a particular window. The window is the widget's
+     * frame, which holds nothing but the border, and the border is only
+     * repainted when set() is given a style different from the one drawn.
      */
     class Border {
         public:
@@ -65,11 +130,15 @@ namespace cursesxx {
 
             ~Border();
 
-            void set( const BorderStyle& );
-            void set( const BorderStyle&& );
+            bool set( const BorderStyle& );
+            bool set( const BorderStyle&& );
+
+            bool drawn() const;
+            void draw( WINDOW* );
 
         private:
             WINDOW* win;
+            std::unique_ptr< BorderStyle > style;
 
             /* trigger compile error */
             Border& operator=( const Border& );
@@ -93,8 +162,8 @@ namespace cursesxx {
             int height() const;
             int width() const;
 
-            int set_height();
-            int set_width(); 
+            void set_height( int );
+            void set_width( int );
 
         private:
             int height_;
@@ -111,7 +180,320 @@ namespace cursesxx {
             Anchor( const bool border = false );
             Anchor( const int y, const int x, const bool border = false  );
             Anchor( const Anchor& base, const Anchor& offset );
-            const int y, x;
+            int y, x;
+    };
+
+    /*
+     * A view of characters owned elsewhere: a std::string, a C string, a
+     * pointer and a length or, from C++17 on, a std::string_view. The text
+     * paths take one, so callers never have to build a std::string first
+     * and nothing is copied on the way to curses.
+     *
+     * Text is UTF-8. size() counts bytes; width() counts the terminal
+     * columns the text takes up, which is what geometry is measured in.
+     */
+    class Text {
+        public:
+            Text( const char* str );
+            Text( const char* str, std::size_t len );
+            Text( const std::string& str );
+#if __cplusplus >= 201703L
+            Text( std::string_view str );
+#endif
+
+            const char* data() const;
+            std::size_t size() const;
+            std::size_t width() const;
+            bool empty() const;
+
+        private:
+            const char* data_;
+            std::size_t size_;
+    };
+
+    /*
+     * Line index over a piece of text, built in a single (vectorised) pass
+     * that finds every newline. It knows the number of lines, the width of
+     * the longest one in columns and where each line starts, so that wrapping, scrolling and
+     * rendering never have to scan the text again. The index does not keep
+     * the text itself; callers pass it back in where it is needed.
+     */
+    class LineIndex {
+        public:
+            struct Row {
+                std::size_t offset, length;
+            };
+
+            LineIndex();
+            LineIndex( const std::string& );
+            LineIndex( const char* text, std::size_t len );
+
+            void assign( const char* text, std::size_t len );
+            void extend( const char* text, std::size_t len );
+
+            std::size_t lines() const;
+            std::size_t longest() const;
+            std::size_t size() const;
+
+            std::size_t begin( std::size_t line ) const;
+            std::size_t length( std::size_t line ) const;
+
+            /*
+             * Breaks lines into rows of at most width columns, preferring
+             * to break after whitespace. text must be the text this index
+             * was built over; the single-line overload only needs the text
+             * of that line, starting at its first character.
+             */
+            std::vector< Row > wrap( const char* text, int width ) const;
+            void wrap( const char* text, int width,
+                    std::size_t line, std::vector< Row >& ) const;
+
+        private:
+            std::vector< std::size_t > starts;
+            std::size_t longest_;
+            std::size_t size_;
+
+            /* width of the last line as far as it has been indexed */
+            std::size_t last_width;
+    };
+
+    /*
+     * Append-friendly text storage. The text lives in a list of chunks, so
+     * appending never reallocates or copies what is already stored. A line is
+     * never split across chunks: when a chunk fills up the unfinished last
+     * line moves on to the next one, keeping every line contiguous.
+     */
+    class TextBuffer {
+        public:
+            TextBuffer();
+            TextBuffer( std::string );
+
+            void assign( const char* text, std::size_t len );
+            void append( const char* text, std::size_t len );
+
+            std::size_t size() const;
+            bool equals( const Text& ) const;
+
+            /* The returned pointer is valid up to the end of pos' line */
+            const char* data( std::size_t pos ) const;
+
+        private:
+            struct Chunk {
+                std::size_t base;
+                std::string text;
+            };
+
+            static const std::size_t chunk_size = 64 * 1024;
+
+            std::vector< Chunk > chunks;
+            std::size_t size_;
+            std::size_t line_start;
+    };
+
+    /*
+     * Editable text with a gap at the cursor: the text before the cursor is
+     * at the start of the buffer and the text after it at the end, with the
+     * free space in between. Inserting and deleting at the cursor only move
+     * the edges of the gap, and moving the cursor moves just the text it
+     * passes over to the other side, so editing costs the same however long
+     * the text is.
+     */
+    class GapBuffer {
+        public:
+            GapBuffer();
+
+            void assign( const char* text, std::size_t len );
+            void insert( const char* text, std::size_t len );
+            std::size_t erase_before( std::size_t n );
+            std::size_t erase_after( std::size_t n );
+            void seek( std::size_t pos );
+
+            std::size_t cursor() const;
+            std::size_t size() const;
+            char at( std::size_t pos ) const;
+
+            /* Appends text[pos, pos + len) to out */
+            void copy( std::size_t pos, std::size_t len,
+                    std::string& out ) const;
+            std::string str() const;
+
+        private:
+            std::vector< char > buffer;
+            std::size_t gap;
+            std::size_t gap_end;
+
+            void reserve( std::size_t n );
+    };
+
+    /*
+     * A set of words, such as command names or hostnames, to complete from.
+     * It is a prefix trie kept in one array of nodes, each linking to its
+     * first child and its next sibling, siblings in byte order. Finding a
+     * prefix costs its length however many words there are, and the words
+     * under it come out in order at the cost of just the ones returned.
+     */
+    class Trie {
+        public:
+            Trie();
+
+            bool add( const Text& );
+            bool contains( const Text& ) const;
+            std::size_t size() const;
+            void clear();
+
+            /*
+             * Puts the first limit (or fewer) words starting with prefix into
+             * out, in byte order, reusing the strings already in it. Returns
+             * the number of words found.
+             */
+            std::size_t complete( const Text& prefix, std::size_t limit,
+                    std::vector< std::string >& out ) const;
+
+            /* The longest text every word starting with prefix continues with */
+            std::string common( const Text& prefix ) const;
+
+        private:
+            struct Node {
+                std::uint32_t child, sibling;
+                unsigned char byte;
+                bool word;
+            };
+
+            std::vector< Node > nodes;
+            std::size_t words = 0;
+
+            std::uint32_t find( const char* text, std::size_t len ) const;
+            void collect( std::uint32_t node, std::string& word,
+                    std::size_t limit, std::vector< std::string >& out,
+                    std::size_t& found ) const;
+    };
+
+    /*
+     * Records what has changed in a window since it was last drawn: the range
+     * of dirty rows and, per row, the dirty column span. A fresh Damage
+     * considers the whole window dirty, as nothing has been drawn yet.
+     */
+    class Damage {
+        public:
+            Damage();
+
+            void mark();
+            void mark( int row );
+            void mark( int row, int first, int last );
+            void mark_rows( int first, int last );
+            void reset();
+
+            bool clean() const;
+            bool dirty( int row ) const;
+            int first( int row ) const;
+            int last( int row ) const;
+
+            /*
+             * Removes the touch marks curses holds for every row that is not
+             * dirty, so a following refresh only looks at changed rows. Dirty
+             * rows keep curses' own (column accurate) change marks.
+             */
+            void apply( WINDOW* ) const;
+
+        private:
+            struct Span {
+                int first, last;
+            };
+
+            bool all;
+            int top, bottom;
+            std::vector< Span > rows;
+    };
+
+    /*
+     * Instrumentation counters, for finding out which widget makes a screen
+     * slow: how often widgets redraw, refresh, write and clear, the time
+     * spent doing so and how many characters they write. Counting is
+     * compiled in only when CURSESXX_STATS is defined. Without it widgets
+     * carry no counters, nothing is counted or timed, and snapshots are
+     * empty.
+     */
+    struct Counters {
+        enum Event { redraw, refresh, write, clear, events };
+
+        Counters();
+        Counters& operator+=( const Counters& );
+        Counters operator-( const Counters& ) const;
+
+        unsigned long calls[ events ];
+        unsigned long long nanoseconds[ events ];
+        unsigned long long chars;
+
+        static const char* name( Event );
+    };
+
+    /*
+     * The live counters of one widget. Scope times and counts one event for
+     * as long as it lives.
+     */
+    class Probe {
+        public:
+#ifdef CURSESXX_STATS
+            class Scope {
+                public:
+                    Scope( Probe&, Counters::Event );
+                    ~Scope();
+
+                private:
+                    Probe& probe;
+                    const Counters::Event event;
+                    const std::chrono::steady_clock::time_point start;
+            };
+
+            explicit Probe( const Widget* );
+            ~Probe();
+
+            void wrote( std::size_t chars );
+            const Counters& counters() const;
+            const Widget& widget() const;
+
+        private:
+            const Widget* owner;
+            std::size_t slot;
+            Counters counters_;
+
+            /* trigger compile error */
+            Probe& operator=( const Probe& );
+            Probe( const Probe& );
+#else
+            class Scope {
+                public:
+                    Scope( Probe&, Counters::Event ) {}
+            };
+
+            explicit Probe( const Widget* ) {}
+            void wrote( std::size_t ) {}
+#endif
+    };
+
+    /*
+     * A snapshot of the counters: the totals over every widget that ever
+     * lived, the share of the last frame, a histogram of frame times and an
+     * entry per live widget, which gives its screen position and size.
+     */
+    class Statistics {
+        public:
+            struct Entry {
+                int y, x, height, width;
+                Counters counters;
+            };
+
+            bool enabled = false;
+            unsigned long frames = 0;
+            Counters total;
+            Counters last_frame;
+
+            /* frame_times[ i ] counts frames that took [2^i, 2^(i+1)) us */
+            std::vector< unsigned long > frame_times;
+            std::vector< Entry > widgets;
+
+            std::string text() const;
+            std::string json() const;
     };
 
     class Widget {
@@ -120,6 +502,31 @@ namespace cursesxx {
          * all frame-and-window related activities; positioning on the screen,
          * drawing, colouring etc. It should also manage and free all resources
          * according to its scope. 
+         *
+         * Widgets constructed with a parent are views into the parent's
+         * window and share its cells; positions are relative to the parent.
+         * Such a child must not outlive its parent. A bordered child given
+         * no geometry fills its parent from its anchor on, border included.
+         *
+         * A bordered widget has two windows: a frame holding the border and
+         * the content window inside it, a view into the frame. Clearing and
+         * writing only ever touch the content, so the border is drawn once
+         * and staged again only when decorate() changes its style.
+         *
+         * Every widget that is not a view into another is a panel, stacked
+         * above the widgets created before it. Redraws go through the panel
+         * library, so a widget never paints over what is stacked above it,
+         * and raising, lowering, hiding, showing, moving or destroying a
+         * widget repaints only the area it exposes. Views are part of their
+         * parent's panel, and raise() and friends do nothing for them.
+         *
+         * Text is written as UTF-8. Lengths are in bytes and positions in
+         * columns; a length that ends inside a character stops before it.
+         *
+         * place() moves and resizes the widget in place, without creating a
+         * new window, to the box at (y, x) of the given size, border
+         * included. The content is cleared. A widget with children of its
+         * own must not be placed; place the children instead.
          */
         public:
             Widget();
@@ -155,19 +562,32 @@ namespace cursesxx {
 
             void redraw();
             void clear();
+            void clear_line( int y, int x = 0 );
+            void clear_below( int y );
+
+            void scroll_up( int n );
 
             void mvhorizontal( int pos );
             void mvvertical( int pos );
             void move( int x, int y );
 
-            void write( const std::string& str );
-            void write( const std::string& str, const int maxlen );
+            void write( const Text& str );
+            void write( const Text& str, const int maxlen );
+            void write( const char* str, int len, int y, int x );
 
             void put( char c );
             void put( char c, int y, int x );
 
             void decorate( const BorderStyle& );
+            void place( int y, int x, int height, int width );
 
+            void raise();
+            void lower();
+            void hide();
+            void show();
+            bool hidden() const;
+
+            Anchor position() const;
             const Widget& get_widget() const;
 
         private:
@@ -175,33 +595,34 @@ namespace cursesxx {
             Anchor anchor;
             int x = 0, y = 0;
 
+            /* the widget this one was made a child of */
+            Widget* container = nullptr;
+
             struct Win {
-                void operator()( WINDOW* ptr ) {
-                    wclear( ptr );
-                    wrefresh( ptr );
-                    delwin( ptr ); 
-                }
+                void operator()( WINDOW* ptr );
+            };
+
+            struct Unstack {
+                void operator()( PANEL* ptr );
             };
 
+            std::unique_ptr< WINDOW, Win > frame;
             std::unique_ptr< WINDOW, Win > window;
             Border decoration;
+            std::unique_ptr< PANEL, Unstack > panel{
+                stack( this->frame.get(), this->window.get() ) };
+            Damage damage;
+            Probe probe{ this };
 
-            friend class Format;
-    };
+            void touched( int y, int x );
+            void propagate( const Damage& ) const;
 
-    /*
-     * Special case of pre-configured Widget. Takes only geometry hints and
-     * calculates center-of-screen placement. Can take a virtual screen as
-     * well.
-     *
-     * Takes only "output types" such as input field, list selectors or boolean
-     * selectors. For a simple message dialogue, give it a bool selector with
-     * one option and ignore the return value.
-     *
-     * All constructors requires an -explicit- geometry argument in order to be
-     * able to calculate position.
-     */
+            static PANEL* stack( WINDOW* frame, WINDOW* window );
+            static void relocate( std::unique_ptr< WINDOW, Win >&, PANEL*,
+                    int y, int x, int height, int width );
 
+            friend class Format;
+    };
 
 
     /*
@@ -217,10 +638,10 @@ namespace cursesxx {
              */
 
             template< typename... Args > 
-                Textfield( const std::string& text, const Args&... );
+                Textfield( std::string text, const Args&... );
 
             template< typename... Args > 
-                Textfield( const std::string& text, const Geometry&, const Args&... );
+                Textfield( std::string text, const Geometry&, const Args&... );
 
             /* This constructor allow proxying arbitrary Widgets (not the
              * only the widget object, but others like Textfield and Panel as well)
@@ -233,23 +654,38 @@ namespace cursesxx {
              */
 
             template< typename Parent, typename... Args >
-                Textfield( const Parent&, const std::string&, const Args&... );
+                Textfield( const Parent&, std::string, const Args&... );
 
             void write();
-            void write( const std::string& );
-            void append( const std::string& );
+            void write( const Text& );
+            void append( const Text& );
 
             void redraw();
             void decorate( const BorderStyle& );
+            void place( int y, int x, int height, int width );
+            void raise();
+            void lower();
+            void hide();
+            void show();
             const Widget& get_widget() const;
 
             static Geometry text_wrap( const std::string&, const int width );
             static Geometry text_wrap( const std::string& );
 
         private:
-            std::string text;
+            TextBuffer text;
+            LineIndex index;
+            std::vector< LineIndex::Row > rows;
+            std::size_t top = 0;
+            std::size_t tail = 0;
             Widget widget;
 
+            /* the next text's index and rows, kept to reuse their memory */
+            LineIndex fresh_index;
+            std::vector< LineIndex::Row > fresh_rows;
+
+            void reflow();
+
             /* unimplemented, so these should trigger an error */
 
             Textfield& operator=( const Textfield& );
@@ -257,175 +693,1540 @@ namespace cursesxx {
 
     };
     /*
-     * Creates a new screen element that is a static label. For now it is
-     * "immutable" in the sense that if you want to change a label (and by
-     * extension resize it) you have to re-create the object.
-     *
-     * Label will not accept any size directions; the Geometry parameters are
-     * disabled compile-time. Its size is calculated based on the size on label
-     * text as well as the horizontal threshold passed as an optional
-     * parameter. In short, it is a stricter Textfield.
+     * A console view over a bounded history of lines, for output that keeps
+     * coming for days. Lines live in a ring that holds at most max_lines
+     * lines and, when max_bytes is non-zero, at most that many bytes of text;
+     * the oldest lines are dropped first. Only the rows in view are drawn.
+     * Paging and jumping only move the viewport, so they cost the same
+     * regardless of how much history is kept.
      *
-     * It takes no explicit Geometry parameters or size hints; instead, it
-     * inherits the attribute of determining breaks from the newlines in the
-     * input string
+     * Lines are not wrapped; anything past the widget's width is cut off.
+     * Line numbers count every line ever pushed, so they stay stable while
+     * old lines are dropped. While the view is at the bottom it follows new
+     * output.
      */
-    class Label {
+    class Scrollback {
         public:
-            Label( const std::string& text = "Label" );
+            template< typename... Args >
+                Scrollback( std::size_t max_lines, std::size_t max_bytes,
+                        const Args&... );
 
-            template< typename... Args > 
-                Label( const Args&... );
+            template< typename Parent, typename... Args >
+                Scrollback( const Parent&,
+                        std::size_t max_lines, std::size_t max_bytes,
+                        const Args&... );
 
+            void push( const Text& );
+
+            void page_up();
+            void page_down();
+            void jump( std::size_t line );
+            void bottom();
+
+            std::size_t first() const;
+            std::size_t end() const;
+
+            void write();
             void redraw();
+            void decorate( const BorderStyle& );
+            void place( int y, int x, int height, int width );
             const Widget& get_widget() const;
 
         private:
-            Textfield widget;
+            std::vector< std::string > ring;
+            std::size_t head = 0;
+            std::size_t count = 0;
+            std::size_t bytes = 0;
+            std::size_t max_bytes;
+            std::size_t dropped = 0;
+
+            /* absolute line numbers of the view and of what is on screen */
+            std::size_t top = 0;
+            std::size_t shown = 0;
+            std::size_t drawn = 0;
+            bool follow = true;
 
-            /* unimplemented, so these should trigger an error */
-            template< typename... Pre, typename... Post > 
-                Label( const Pre&..., const Geometry&, const Post&... );
+            Widget widget;
 
-            Label& operator=( const Label& );
-            Label( const Label& );
+            void push_line( const char* text, std::size_t len );
+            void drop();
+            void draw( std::size_t line );
+            std::size_t rows() const;
+
+            /* unimplemented, so these should trigger an error */
+            Scrollback& operator=( const Scrollback& );
+            Scrollback( const Scrollback& );
     };
 
-    /* A generic button. Hitting it will return a value, which will either be a
-     * function or a simple return value. 
+    /*
+     * A table of text cells for up to millions of rows. Cells are stored
+     * column by column, with all of a column's text in one buffer. Only the
+     * rows in view are drawn, into a single window: a row of headings, then
+     * one line per table row. Each column is as wide as its widest cell
+     * (or heading). The widest cell is tracked as cells change, without
+     * looking at the other cells. Columns past the right edge are cut off.
+     *
+     * sort() and filter() run on a worker thread over a snapshot of the
+     * columns they read, so the UI thread is never held up. The new row
+     * order replaces the old one in a single swap, in the first redraw()
+     * after the worker is done. Rows added after the snapshot was taken
+     * follow the sorted rows, in the order they were added. Rows that
+     * change keep their place until the next sort() or filter(). A column
+     * still read by the worker is copied before it is changed. Given a
+     * Channel, the worker posts a redraw() to it when done, just like
+     * Channel::write does for a Textfield.
+     *
+     * Cells that are numbers sort as numbers, ahead of all other cells in
+     * ascending order; other cells sort bytewise. Filtering keeps the rows
+     * whose cell in the given column contains the given text.
      */
+    class Table {
+        public:
+            static const std::size_t none;
 
-    template< typename Return >
-        class Button {
-            public:
-                template< typename... Args >
-                    Button( const std::string& text,
-                            bool action,
-                            const Args&... params );
+            template< typename... Args >
+                Table( std::vector< std::string > headings, const Args&... );
 
-                template< typename... Args >
-                    Button( const std::string& text,
-                            bool action,
-                            std::function< void(Button< Return >&) > focus,
-                            std::function< void(Button< Return >&) > unfocus,
-                            const Args&... params );
+            template< typename Parent, typename... Args >
+                Table( const Parent&, std::vector< std::string > headings,
+                        const Args&... );
 
-                template< typename Action, typename... Args >
-                    Button( const std::string& text,
-                            const Action& action,
-                            const Args&... params );
+            ~Table();
 
-                template< typename Action, typename... Args >
-                    Button( const std::string& text,
-                            const Action& action,
-                            std::function< void(Button< Return >&) > focus,
-                            std::function< void(Button< Return >&) > unfocus,
-                            const Args&... params );
+            std::size_t add( std::initializer_list< Text > );
+            std::size_t add( const std::vector< std::string >& );
+            void set( std::size_t row, std::size_t column, const Text& );
+            void clear();
 
-                void focus();
-                void unfocus();
-                Return trigger();
+            Text cell( std::size_t row, std::size_t column ) const;
+            std::size_t rows() const;
+            std::size_t columns() const;
+            std::size_t width( std::size_t column ) const;
 
-                void redraw();
-                const Widget& get_widget() const;
+            /* The rows that pass the filter, in view order */
+            std::size_t listed() const;
+            std::size_t row_at( std::size_t position ) const;
 
-            private:
-                std::function< Return() > action;
-                std::function< void(Button<Return>&) > focus_;
-                std::function< void(Button<Return>&) > unfocus_;
-                Label widget;
+            void sort( std::size_t column, bool descending = false );
+            void filter( std::size_t column, std::string needle );
+            void notify( Channel& );
 
-                static void default_focus( Button< Return >& );
-                static void default_unfocus( Button< Return >& );
-        };
+            /* Whether a sort or filter has yet to be swapped in */
+            bool busy() const;
 
-    class Application {
-        public:
-            Application& keypad( const bool enable = true );
-            Application& echo( const bool enable = true );
-            Application& cursor( const bool enable = true );
+            void page_up();
+            void page_down();
+            void jump( std::size_t position );
+
+            void write();
+            void redraw();
+            void decorate( const BorderStyle& );
+            void place( int y, int x, int height, int width );
+            const Widget& get_widget() const;
 
         private:
-            class Screen {
-                public:
-                    Screen();
-                    ~Screen();
-                    /* This wrapper class makes sure the curses initialization
-                     * happens before any members tries to create and draw
-                     * their windows.
-                     */
+            struct Cell {
+                std::size_t offset;
+                std::uint32_t length;
+                std::uint32_t width;
             };
-            Screen screen;
-    };
 
+            struct Column {
+                std::string text;
+                std::vector< Cell > cells;
+                std::size_t garbage = 0;
 
-    int mid( int A, int B );
-    Anchor mid( const Geometry& child );
-    Anchor mid( const Widget& parent, const Geometry& child );
+                /* the number of cells of every width, and the widest */
+                std::vector< std::size_t > widths;
+                std::size_t widest = 0;
 
-    /* TEMPLATE IMPLEMENTATIONS */
+                Text at( std::size_t row ) const;
+                void push( const Text& );
+                void replace( std::size_t row, const Text& );
+                void count( std::size_t width, bool added );
+                void compact();
+            };
 
-    /* UTILITIES */
+            typedef std::vector< std::uint32_t > Order;
 
-    template< typename T >
-        WINDOW* Format::get_win( const T& widget ) {
-            return Format::get_win( widget.get_widget() );
-        }
+            /* a sort and filter over a snapshot of the first rows rows */
+            struct Job {
+                unsigned long generation;
+                std::size_t rows;
+                std::shared_ptr< const Column > key;
+                bool descending;
+                std::shared_ptr< const Column > match;
+                std::string needle;
+            };
 
-    /* CONSTRUCTORS */
-    template< typename T >
-        Format::Format( const T& widget, int bitmask ) :
-            win( Format::get_win( widget ) ),
-            bitmask( bitmask )
-    {
-        wattron( this->win, bitmask );
-    }
+            struct Result {
+                unsigned long generation;
+                std::size_t rows;
+                Order order;
+            };
 
+            std::vector< std::string > headings;
+            std::vector< std::shared_ptr< Column > > data;
+            std::size_t count = 0;
+            Order order;
 
-    template< typename... Args > 
-        Textfield::Textfield( const std::string& text, const Args&... args ) :
-            Textfield( text, Textfield::text_wrap( text ), args... )
-    {}
+            std::size_t sort_column = none;
+            bool descending = false;
+            std::size_t filter_column = none;
+            std::string needle;
 
-    template< typename... Args > 
-        Textfield::Textfield( const std::string& text,
-                const Geometry& g,
-                const Args&... args ):
-            text( text ),
-            widget( g, args... )
-    {
-        this->widget.write( text );
-    }
+            std::size_t top = 0;
+            bool stale = true;
+            std::string line;
 
-    template< typename Parent, typename... Args >
-        Textfield::Textfield( const Parent& p,
-                const std::string& text,
+            Widget widget;
+
+            /* the worker, and what passes between it and the UI thread */
+            std::thread worker;
+            std::mutex lock;
+            std::condition_variable wake;
+            std::unique_ptr< Job > job;
+            bool stopping = false;
+            unsigned long requested = 0;
+            unsigned long applied = 0;
+            std::shared_ptr< Result > done;
+            std::atomic< Channel* > channel{ nullptr };
+
+            void init();
+            Column& column( std::size_t );
+            bool passes( std::size_t row ) const;
+            bool visible( std::size_t row ) const;
+            void push( std::size_t column, const Text& );
+            void append( std::size_t row );
+            void schedule();
+            void work();
+            void adopt();
+            void draw( int y, std::size_t row );
+            std::size_t page() const;
+
+            static void arrange( const Job&, Order& );
+
+            /* unimplemented, so these should trigger an error */
+            Table& operator=( const Table& );
+            Table( const Table& );
+    };
+
+    /*
+     * A live chart of the last capacity samples, the newest on the right.
+     * Samples go into a ring that is allocated up front, so push() is
+     * constant time and never allocates; it only marks the chart for
+     * redrawing. All the work is left to redraw(), once per frame however
+     * many samples came in.
+     *
+     * The samples are split into one bucket per column of resolution and
+     * each bucket is reduced to its minimum, maximum and mean, a vector at a
+     * time. bars draws the mean of one bucket per column as a bar in eighths
+     * of a cell, in block characters. dots draws two buckets per column, in
+     * braille, each as a line of dots from its minimum to its maximum, so
+     * spikes stay visible however many samples fall into a bucket. The
+     * scale follows the samples in view unless set with range().
+     *
+     * Rows are laid out in a buffer and written a whole row at a time.
+     * Charts cannot be copied.
+     */
+    class Chart {
+        public:
+            enum Style { bars, dots };
+
+            template< typename... Args >
+                Chart( std::size_t capacity, const Args&... );
+
+            template< typename Parent, typename... Args >
+                Chart( const Parent&, std::size_t capacity, const Args&... );
+
+            void push( double sample );
+            void clear();
+            std::size_t size() const;
+
+            void style( Style );
+            void range( double low, double high );
+            void autoscale();
+
+            void write();
+            void redraw();
+            void decorate( const BorderStyle& );
+            void place( int y, int x, int height, int width );
+            const Widget& get_widget() const;
+
+        private:
+            struct Bucket {
+                double low, high, sum;
+                std::size_t count;
+            };
+
+            std::vector< double > ring;
+            std::size_t head = 0;
+            std::size_t count = 0;
+
+            Style style_ = bars;
+            bool fixed = false;
+            double low = 0, high = 0;
+            bool stale = true;
+
+            /* reused from frame to frame, so drawing does not allocate */
+            std::vector< Bucket > buckets;
+            std::vector< int > levels;
+            std::string line;
+
+            Widget widget;
+
+            void decimate( std::size_t n );
+            void reduce( std::size_t from, std::size_t to, Bucket& ) const;
+            void draw_bars( int height, int width );
+            void draw_dots( int height, int width );
+
+            /* unimplemented, so these should trigger an error */
+            Chart& operator=( const Chart& );
+            Chart( const Chart& );
+    };
+
+    /*
+     * A line of input being edited, or several lines. The text is kept in a
+     * gap buffer split at the cursor, so typing and deleting cost the same
+     * however long it is. An edit only redraws its row from where it was
+     * made, plus the rows below when it splits or joins lines. Rows are not
+     * wrapped; the view scrolls to keep the cursor in sight, and the cursor
+     * is shown in reverse while the editor has focus.
+     *
+     * key() takes keys from the Application's key handler and returns
+     * whether the editor used the key: characters (UTF-8 comes in a byte at
+     * a time), the arrow keys, Home and End (or ^A and ^E), Backspace and
+     * Delete. Enter submits a single line: the text goes to the submit
+     * handler and into the history, and the editor is emptied. In a
+     * multiline editor Enter breaks the line, and the keypad's Enter or
+     * submit() submits. Up and Down step through the history, from the
+     * first or the last line, coming back to what was being typed.
+     * The history keeps the last history entries.
+     *
+     * Given a Trie, Tab completes the word before the cursor as far as all
+     * the words it could become agree, and suggestions() lists them.
+     */
+    class Editor {
+        public:
+            template< typename... Args >
+                Editor( std::size_t history, const Args&... );
+
+            template< typename Parent, typename... Args >
+                Editor( const Parent&, std::size_t history, const Args&... );
+
+            void multiline( bool enable = true );
+            void completions( const Trie* );
+            void on_submit( std::function< void( const std::string& ) > );
+
+            bool key( int );
+            void insert( const Text& );
+            void set( const Text& );
+            void submit();
+
+            std::string text() const;
+            std::size_t cursor() const;
+            std::size_t suggestions( std::size_t limit,
+                    std::vector< std::string >& ) const;
+
+            void focus();
+            void unfocus();
+
+            void write();
+            void redraw();
+            void decorate( const BorderStyle& );
+            void place( int y, int x, int height, int width );
+            const Widget& get_widget() const;
+
+        private:
+            GapBuffer buffer;
+            bool multiline_ = false;
+            const Trie* words = nullptr;
+            std::function< void( const std::string& ) > submitted;
+
+            /* the history ring, and how far back in it the text is from */
+            std::vector< std::string > history;
+            std::size_t head = 0;
+            std::size_t count = 0;
+            std::size_t back = 0;
+            std::string draft;
+
+            /* the cursor's line, where that line starts, the cursor's column
+             * in it, and the column kept while moving up and down */
+            std::size_t line = 0;
+            std::size_t line_start = 0;
+            std::size_t col = 0;
+            std::size_t goal;
+
+            /* the first line and column in view, and where that line starts */
+            std::size_t top = 0;
+            std::size_t top_start = 0;
+            std::size_t left = 0;
+
+            /* the cursor on screen; rows that need drawing again */
+            bool focused = false;
+            int cursor_row = 0, cursor_col = 0;
+            Damage damage;
+            std::string row;
+
+            Widget widget;
+
+            void insert_line( const char* text, std::size_t len );
+            void erase_before();
+            void erase_after();
+            void step( bool forward );
+            void vertical( bool down );
+            void home();
+            void end();
+            void complete();
+            void recall( bool older );
+            void replace( const char* text, std::size_t len );
+            void edited();
+            void follow();
+            void layout();
+            void draw( int y, std::size_t start, int from );
+
+            std::size_t start_of( std::size_t pos ) const;
+            std::size_t end_of( std::size_t pos ) const;
+            std::size_t span( std::size_t from, std::size_t to );
+            void measure();
+            std::size_t advance( std::size_t from, std::size_t to );
+            std::string word() const;
+
+            /* unimplemented, so these should trigger an error */
+            Editor& operator=( const Editor& );
+            Editor( const Editor& );
+    };
+
+    /*
+     * Picks one of up to millions of items by fuzzy matching. An item
+     * matches if the query's characters appear in it in order, not
+     * necessarily next to each other; ASCII letters match in either case.
+     * Matches rank by how well the characters line up, which favours runs
+     * and the starts of words, then by length, shortest first. The first
+     * row shows the prompt, the query and the number of matches. The best
+     * matches are listed below it, with the one under the cursor in reverse.
+     *
+     * Searches run off the UI thread. Each is cut into chunks, which one
+     * thread per core (or as many as given to threads()) takes in turn.
+     * Every thread keeps only the best matches, as many as the view can
+     * scroll through, so only those get ranked; scrolling further asks for
+     * more. A query that contains one of the last few queries searched (in
+     * order, e.g. one typed further) only looks through that query's
+     * matches. A key that changes the query cancels the search in progress
+     * at the next chunk. The old
+     * matches stay on screen until the first redraw() after the new ones
+     * are in, so typing never waits for a search. Given a Channel, a
+     * finished search posts a redraw() to it.
+     *
+     * key() takes:
+     * - characters, Backspace, and ^U to empty the query;
+     * - Up and Down (or ^P and ^N), Page Up and Page Down;
+     * - Enter, which passes the item under the cursor to the select handler.
+     *
+     * Items are kept like a Table's column, and are copied before they
+     * change if a search is reading them. While there is a query, added
+     * items are searched the next time the query changes, or on search().
+     */
+    class Selector {
+        public:
+            static const std::size_t none;
+
+            template< typename... Args >
+                Selector( std::string prompt, const Args&... );
+
+            template< typename Parent, typename... Args >
+                Selector( const Parent&, std::string prompt, const Args&... );
+
+            ~Selector();
+
+            std::size_t add( const Text& );
+            void add( const std::vector< std::string >& );
+            void clear();
+            std::size_t size() const;
+            Text item( std::size_t ) const;
+
+            void search( std::string query );
+            const std::string& query() const;
+            bool key( int );
+            void on_select( std::function< void( std::size_t ) > );
+            void notify( Channel& );
+
+            /* The threads start with the first search, and stay as many */
+            void threads( unsigned );
+
+            /* The matches swapped in, in rank order, and the one selected */
+            std::size_t matched() const;
+            std::size_t listed() const;
+            std::size_t item_at( std::size_t position ) const;
+            std::size_t selected() const;
+
+            /* Whether a search has yet to be swapped in */
+            bool busy() const;
+
+            void write();
+            void redraw();
+            void decorate( const BorderStyle& );
+            void place( int y, int x, int height, int width );
+            const Widget& get_widget() const;
+
+        private:
+            struct Items {
+                std::string text;
+                /* where every item starts, then where the last one ends */
+                std::vector< std::size_t > starts = { 0 };
+                /* the bytes in every item, folded into 64 bits */
+                std::vector< std::uint64_t > masks;
+
+                Text at( std::size_t ) const;
+                void push( const Text& );
+            };
+
+            typedef std::vector< std::uint32_t > Order;
+
+            /* the matches of query in the first rows items, and the best */
+            struct Result {
+                std::string query;
+                unsigned long epoch;
+                std::size_t rows;
+                Order matches;
+                Order best;
+            };
+
+            struct Job {
+                unsigned long generation;
+                unsigned long epoch;
+                std::size_t rows;
+                std::size_t depth;
+                std::string query;
+                std::shared_ptr< const Items > items;
+            };
+
+            struct Done {
+                unsigned long generation;
+                std::shared_ptr< const Result > result;
+            };
+
+            /* one search, shared by the threads taking its chunks */
+            struct Search;
+
+            std::string prompt;
+            std::string query_;
+            std::shared_ptr< Items > items;
+            unsigned long epoch = 0;
+            std::function< void( std::size_t ) > selected_;
+            unsigned threads_ = 0;
+
+            /* what is listed; every item, in order, when there is none */
+            std::shared_ptr< const Result > shown;
+            std::size_t depth = 0;
+            std::size_t cursor = 0;
+            std::size_t top = 0;
+
+            /* the items on screen, the row in reverse, and the first row */
+            std::vector< std::size_t > drawn;
+            int lit = -1;
+            std::string status;
+            bool stale = true;
+            std::string line;
+
+            Widget widget;
+
+            /*
+             * The thread handing out searches, its helpers, and what passes
+             * between them and the UI thread
+             */
+            std::thread worker;
+            std::vector< std::thread > helpers;
+            std::mutex lock;
+            std::condition_variable wake;
+            std::condition_variable start;
+            std::condition_variable finished;
+            std::unique_ptr< Job > job;
+            bool stopping = false;
+            Search* current = nullptr;
+            unsigned long round = 0;
+            std::atomic< unsigned long > requested{ 0 };
+            unsigned long applied = 0;
+            std::shared_ptr< Done > done;
+            std::atomic< Channel* > channel{ nullptr };
+
+            /* the last results, for queries that refine them; worker only */
+            std::vector< std::shared_ptr< const Result > > recent;
+
+            Items& own();
+            void schedule( std::size_t depth );
+            void work();
+            void help();
+            void scan( Search& );
+            void adopt();
+            void move( std::ptrdiff_t );
+            std::size_t page() const;
+            void paint( bool all );
+            void draw_status();
+            void draw( int y, std::size_t item, bool selected );
+
+            /* unimplemented, so these should trigger an error */
+            Selector& operator=( const Selector& );
+            Selector( const Selector& );
+    };
+
+    /*
+     * Creates a new screen element that is a static label. For now it is
+     * "immutable" in the sense that if you want to change a label (and by
+     * extension resize it) you have to re-create the object.
+     *
+     * Label will not accept any size directions; the Geometry parameters are
+     * disabled compile-time. Its size is calculated based on the size on label
+     * text as well as the horizontal threshold passed as an optional
+     * parameter. In short, it is a stricter Textfield.
+     *
+     * It takes no explicit Geometry parameters or size hints; instead, it
+     * inherits the attribute of determining breaks from the newlines in the
+     * input string
+     */
+    class Label {
+        public:
+            Label( std::string text = "Label" );
+
+            template< typename... Args > 
+                Label( std::string text, const Args&... );
+
+            void redraw();
+            void place( int y, int x, int height, int width );
+            const Widget& get_widget() const;
+
+        private:
+            Textfield widget;
+
+            /* unimplemented, so these should trigger an error */
+            template< typename... Pre, typename... Post > 
+                Label( const Pre&..., const Geometry&, const Post&... );
+
+            Label& operator=( const Label& );
+            Label( const Label& );
+    };
+
+    /*
+     * Special case of pre-configured Widget. Takes only geometry hints and
+     * calculates center-of-screen placement, and is stacked on top of
+     * everything on screen when shown, covering it without it having to be
+     * repainted; hiding or destroying the dialog repaints only what it
+     * covered.
+     *
+     * Shows a bordered message. Selectors go inside it as children, e.g.
+     * Selector( dialog, "> ", ... ), Textfield( dialog, ... ) or
+     * Widget( dialog.get_widget(), ... ).
+     *
+     * All constructors requires an -explicit- geometry argument in order to be
+     * able to calculate position.
+     */
+    class Dialog {
+        public:
+            Dialog( const Geometry&, std::string message );
+            Dialog( const Geometry&, std::string message, const BorderStyle& );
+
+            void write( const Text& );
+            void show();
+            void hide();
+            bool hidden() const;
+
+            void redraw();
+            const Widget& get_widget() const;
+
+        private:
+            Widget frame;
+            Textfield message;
+
+            /* trigger compile error */
+            Dialog& operator=( const Dialog& );
+            Dialog( const Dialog& );
+    };
+
+    /* A generic button. Hitting it will return a value, which will either be a
+     * function or a simple return value. 
+     *
+     * Tasks can wait for it with co_await pressed(), which gives them what
+     * the next trigger() returns; trigger() resumes them before it returns.
+     */
+
+    template< typename Return >
+        class Button {
+            public:
+                template< typename... Args >
+                    Button( std::string text,
+                            bool action,
+                            const Args&... params );
+
+                template< typename... Args >
+                    Button( std::string text,
+                            bool action,
+                            std::function< void(Button< Return >&) > focus,
+                            std::function< void(Button< Return >&) > unfocus,
+                            const Args&... params );
+
+                template< typename Action, typename... Args >
+                    Button( std::string text,
+                            const Action& action,
+                            const Args&... params );
+
+                template< typename Action, typename... Args >
+                    Button( std::string text,
+                            const Action& action,
+                            std::function< void(Button< Return >&) > focus,
+                            std::function< void(Button< Return >&) > unfocus,
+                            const Args&... params );
+
+                void focus();
+                void unfocus();
+                Return trigger();
+
+                void redraw();
+                const Widget& get_widget() const;
+
+#if __cplusplus >= 202002L
+                class Pressed {
+                    public:
+                        explicit Pressed( Button& );
+                        ~Pressed();
+
+                        bool await_ready() const noexcept;
+                        void await_suspend( std::coroutine_handle<> );
+                        Return await_resume();
+
+                    private:
+                        typedef std::conditional_t< std::is_void_v< Return >,
+                                bool, Return > Value;
+
+                        Button& button;
+                        bool waiting = false;
+                        std::optional< Value > value;
+                };
+
+                Pressed pressed();
+#endif
+
+            private:
+                std::function< Return() > action;
+                std::function< void(Button<Return>&) > focus_;
+                std::function< void(Button<Return>&) > unfocus_;
+                Label widget;
+
+                /* what is waiting for the next trigger(), given its result,
+                 * and what trigger() is waking up now */
+                std::vector< std::pair< const void*,
+                    std::function< void( const void* ) > > > waiting, waking;
+
+                void wake( const void* result );
+
+                static void default_focus( Button< Return >& );
+                static void default_unfocus( Button< Return >& );
+        };
+
+    /*
+     * Focus styles for StaticButton. A style is a policy class with static
+     * focus() and unfocus() functions taking the button.
+     */
+    struct BoldFocus {
+        template< typename B > static void focus( B& );
+        template< typename B > static void unfocus( B& );
+    };
+
+    struct ReverseFocus {
+        template< typename B > static void focus( B& );
+        template< typename B > static void unfocus( B& );
+    };
+
+    /* An action that always returns the same value */
+    template< typename T >
+        class Constant {
+            public:
+                Constant( T value );
+                T operator()() const;
+
+            private:
+                T value;
+        };
+
+    /*
+     * Button with its action and focus style fixed at compile time. The
+     * action is stored as its own type rather than in a std::function, and
+     * the style is a policy, so nothing is type-erased or allocated for
+     * them and the calls can be inlined; a button costs its label and its
+     * action's state, which for a plain lambda is nothing.
+     *
+     *     StaticButton< Constant< bool > > ok( "OK", true );
+     *
+     *     auto quit = [&]{ app.quit(); };
+     *     StaticButton< decltype( quit ), ReverseFocus > q( "Quit", quit );
+     */
+    template< typename Action, typename Style = BoldFocus >
+        class StaticButton {
+            public:
+                template< typename... Args >
+                    StaticButton( std::string text, Action action,
+                            const Args&... params );
+
+                void focus();
+                void unfocus();
+                auto trigger() -> decltype( std::declval< Action& >()() );
+
+                void redraw();
+                void place( int y, int x, int height, int width );
+                const Widget& get_widget() const;
+
+            private:
+                Action action;
+                Label widget;
+        };
+
+    /*
+     * How a layout sizes one of its items along the layout's direction: a
+     * share of the free space proportional to weight, but never less than
+     * min or more than max cells.
+     */
+    class Constraint {
+        public:
+            Constraint( int weight = 1, int min = 0,
+                    int max = std::numeric_limits< int >::max() );
+
+            int weight, min, max;
+    };
+
+    /*
+     * Arranges widgets in rows, columns or grids, nested to any depth, inside
+     * an area of the screen (the whole screen unless placed otherwise).
+     * Anything with place( y, x, height, width ) and redraw() methods can
+     * be added, which includes Widget, Textfield, Scrollback and Label;
+     * layouts are nested with nest().
+     *
+     * Rows and columns split their area, less the padding on every side,
+     * between their items by Constraint in a single pass; space a capped
+     * item leaves over goes to the items after it. Items of a grid fill it
+     * row by row; columns take their constraints from the items in the
+     * first row, rows from the first item in each row.
+     *
+     * Nothing moves until update(), which only lays out again the layouts
+     * whose items, constraints, padding or area changed since the last
+     * update, and only places (and redraws) the items that end up somewhere
+     * new. Run it inside a Frame to get the result on screen in one go, or
+     * attach the layout to the Application, which keeps it covering the
+     * screen and updates it every frame.
+     *
+     * A nested layout belongs to the layout it was nested in. Layouts cannot
+     * be copied, and items must outlive the layout they are in.
+     */
+    class Layout {
+        public:
+            enum Kind { row, column, grid };
+
+            Layout( Kind kind = column, int columns = 1 );
+
+            template< typename T >
+                std::size_t add( T& item,
+                        const Constraint& constraint = Constraint() );
+
+            Layout& nest( Kind kind,
+                    const Constraint& constraint = Constraint(),
+                    int columns = 1 );
+
+            void constrain( std::size_t item, const Constraint& );
+            void constrain( const Constraint& );
+            void padding( int cells );
+
+            void place( int y, int x, int height, int width );
+            void update();
+
+        private:
+            struct Item {
+                Item( const Constraint& );
+
+                Constraint constraint;
+                std::function< void( int, int, int, int ) > place;
+                std::unique_ptr< Layout > nested;
+                int y, x, height, width;
+            };
+
+            Kind kind;
+            int columns;
+            int padding_ = 0;
+            int y = 0, x = 0, height, width;
+
+            std::vector< Item > items;
+            Layout* parent = nullptr;
+            std::size_t slot = 0;
+
+            /* this layout needs arranging, or some layout nested in it does */
+            bool dirty = true;
+            bool pending = false;
+
+            void mark();
+            void arrange();
+            void assign( Item&, int y, int x, int height, int width );
+
+            /* trigger compile error */
+            Layout& operator=( const Layout& );
+            Layout( const Layout& );
+    };
+
+    /*
+     * Knows which widget is at which screen cell, for routing mouse clicks
+     * and for moving focus with the arrow keys. Entries are bucketed in a
+     * uniform grid of cell x cell squares, so finding what is under a point
+     * looks at one bucket whatever the number of widgets, and moving an
+     * entry only touches the buckets it leaves and enters.
+     *
+     * Entries are boxes in screen coordinates, either given directly or
+     * read from a widget's position and size; update() reads them again
+     * after the widget moved. Where entries overlap, the one added last is
+     * on top. Focusable entries (buttons) get focus() and unfocus() calls,
+     * and navigate() moves the focus to the nearest focusable entry in the
+     * direction of an arrow key, searching the buckets outwards in rings
+     * and stopping as soon as nothing further away can be nearer.
+     *
+     * Attach it to an Application to have mouse events and arrow keys
+     * routed to it; keys it does not handle still go to the key handler.
+     */
+    class SpatialIndex {
+        public:
+            typedef std::size_t Id;
+            typedef std::function< void( const MEVENT& ) > Click;
+
+            static const Id none;
+
+            explicit SpatialIndex( int cell = 8 );
+
+            template< typename T >
+                Id add( const T& widget, Click click = nullptr );
+
+            template< typename B >
+                Id add_focusable( B& button, Click click = nullptr );
+
+            template< typename T >
+                void update( Id, const T& widget );
+
+            Id add( int y, int x, int height, int width,
+                    Click click = nullptr,
+                    std::function< void( bool ) > focus = nullptr );
+            void move( Id, int y, int x, int height, int width );
+            void remove( Id );
+
+            Id at( int y, int x ) const;
+            bool click( const MEVENT& );
+
+            Id focused() const;
+            void focus( Id );
+            bool navigate( int key );
+
+        private:
+            struct Entry {
+                int y, x, height, width;
+                Click click;
+                std::function< void( bool ) > focus;
+                bool live;
+            };
+
+            int cell;
+            int rows = 0, cols = 0;
+            std::vector< Entry > entries;
+            std::vector< std::vector< Id > > buckets;
+            Id current = none;
+
+            void insert( Id );
+            void erase( Id );
+            void fit( const Entry& );
+            std::vector< Id >* bucket( int row, int col );
+    };
+
+    /*
+     * Carries updates from worker threads to the UI thread, which is the
+     * only thread that may touch curses. Producers post closures without
+     * taking a lock (an intrusive multi-producer, single-consumer queue);
+     * the UI thread applies everything posted since last time in one batch
+     * with drain(), which an attached Application does once per frame.
+     *
+     * Updates posted with a key replace earlier updates with the same key in
+     * the same batch, so a fast producer costs one update per frame rather
+     * than one per post. Keys are usually the widget the update is for.
+     * An object that posts for itself calls forget() with its key when it
+     * is destroyed, which drops whatever it posted that has yet to be
+     * applied; updates posted with that key later are applied as usual.
+     */
+    class Channel {
+        public:
+            Channel();
+            ~Channel();
+
+            /* Any thread */
+            void post( std::function< void() > update );
+            void post( const void* key, std::function< void() > update );
+
+            void write( Textfield&, const std::string& );
+            void append( Textfield&, const std::string& );
+
+            /* UI thread only */
+            std::size_t drain();
+            void forget( const void* key );
+            int fd() const;
+
+        private:
+            struct Node {
+                std::atomic< Node* > next;
+                const void* key;
+                unsigned long serial;
+                std::function< void() > update;
+            };
+
+            std::atomic< Node* > head;
+            Node* tail;
+            Node stub;
+
+            int event;
+            std::atomic< bool > signalled;
+            std::vector< Node* > batch;
+            std::unordered_set< const void* > seen;
+
+            /* keys forgotten, with the serial of the first post to keep */
+            std::atomic< unsigned long > serials;
+            std::unordered_map< const void*, unsigned long > forgotten;
+
+            void push( Node* );
+            Node* pop( bool& busy );
+            void signal();
+            void acknowledge();
+
+            friend class Application;
+
+            /* trigger compile error */
+            Channel& operator=( const Channel& );
+            Channel( const Channel& );
+    };
+
+    /*
+     * A render backend of our own, used instead of doupdate() once given to
+     * Application::render(). Widgets still draw into curses windows and
+     * frames still stage them on the virtual screen; the renderer then
+     * reads the changed rows of the virtual screen, compares them cell by
+     * cell (glyph, attributes and colour pair) with the front grid of what
+     * the terminal shows, and sends only the changed cells, with the cursor
+     * moves and SGR changes they need, in a single write(). Glyphs are sent
+     * as UTF-8.
+     *
+     * The sequences are plain ANSI (CUP, SGR with 256 colours, DEC line
+     * drawing) rather than looked up in terminfo, so the terminal must be
+     * xterm compatible. With a descriptor of -1 nothing is written, which
+     * together with cell() and line() makes a headless target for tests.
+     * cell() packs attributes and glyph into a chtype, so glyphs outside
+     * ASCII read as '?'; line() has the row as UTF-8, and pair() the cell's
+     * colour pair, in full.
+     */
+    class Renderer {
+        public:
+            explicit Renderer( int fd = -1 );
+
+            void present();
+            void invalidate();
+
+            chtype cell( int y, int x ) const;
+            std::string line( int y ) const;
+            int pair( int y, int x ) const;
+            std::size_t written() const;
+
+        private:
+            int fd;
+            int height = 0, width = 0;
+            std::vector< cchar_t > front;
+
+            /* the row of the virtual screen being compared */
+            std::vector< cchar_t > back;
+            std::string out;
+            std::size_t written_ = 0;
+
+            /* what the terminal is in: cursor position and rendition */
+            int cy = -1, cx = -1;
+            attr_t rendition = 0;
+            int colours = 0;
+
+            void move( int y, int x );
+            void style( attr_t, int pair );
+            void flush();
+    };
+
+#if __cplusplus >= 202002L
+    class Application;
+
+    template< typename T >
+        class TaskResult {
+            public:
+                void return_value( T value ) {
+                    this->value.emplace( std::move( value ) );
+                }
+
+            protected:
+                std::optional< T > value;
+
+                T take() { return std::move( *this->value ); }
+        };
+
+    template<>
+        class TaskResult< void > {
+            public:
+                void return_void() {}
+
+            protected:
+                void take() {}
+        };
+
+    /*
+     * A coroutine run on the UI thread by the Application's event loop.
+     * Interactive flows are written as straight-line code that waits for
+     * keys, timers and buttons (see Application::key() and sleep(), and
+     * Button::pressed()) without a thread or a blocking read of its own; a
+     * waiting task costs its coroutine frame and nothing else.
+     *
+     *     Task<> wizard( Application& app, Button< bool >& ok ) {
+     *         const int key = co_await app.key();
+     *         co_await app.sleep( std::chrono::milliseconds( 500 ) );
+     *         if( co_await ok.pressed() ) co_return;
+     *     }
+     *
+     *     app.spawn( wizard( app, ok ) );
+     *
+     * A task does not start until it is either awaited by another task,
+     * which it hands its result to when done, or given to spawn(). An
+     * exception a task does not catch goes to the task awaiting it or, for
+     * a spawned task, out of run(), once everything woken up along with
+     * the task has run. Should more spawned tasks fail before that, only
+     * the first exception comes out.
+     *
+     * Needs C++20.
+     */
+    template< typename T = void >
+        class Task {
+            public:
+                class promise_type : public TaskResult< T > {
+                    public:
+                        struct Final {
+                            bool await_ready() noexcept { return false; }
+                            std::coroutine_handle<> await_suspend(
+                                    std::coroutine_handle< promise_type > )
+                                noexcept;
+                            void await_resume() noexcept {}
+                        };
+
+                        Task get_return_object();
+                        std::suspend_always initial_suspend() noexcept {
+                            return {};
+                        }
+                        Final final_suspend() noexcept { return {}; }
+                        void unhandled_exception();
+
+                    private:
+                        std::coroutine_handle<> continuation;
+                        Application* owner = nullptr;
+                        std::exception_ptr error;
+
+                        friend class Task;
+                        friend class Application;
+                };
+
+                typedef std::coroutine_handle< promise_type > Handle;
+
+                Task( Task&& ) noexcept;
+                ~Task();
+
+                bool await_ready() const noexcept;
+                std::coroutine_handle<> await_suspend(
+                        std::coroutine_handle<> ) noexcept;
+                T await_resume();
+
+            private:
+                Handle handle;
+
+                explicit Task( Handle );
+                friend class Application;
+
+                /* trigger compile error */
+                Task& operator=( const Task& );
+                Task( const Task& );
+        };
+#endif
+
+    class Application {
+        public:
+            Application& keypad( const bool enable = true );
+            Application& echo( const bool enable = true );
+            Application& cursor( const bool enable = true );
+
+            /*
+             * Frames batch screen updates. Between begin_frame() and commit()
+             * widget redraws only stage their windows on the virtual screen
+             * (wnoutrefresh), and commit() sends all of it to the terminal
+             * with a single doupdate(). Frames nest; only the outermost
+             * commit() flushes; a commit() without a begin_frame() does
+             * nothing. Outside a frame every redraw is flushed immediately,
+             * as before. Frames belong to the Application, and hold back the
+             * redraws on its screen; with more than one, redraws go by the
+             * frames of the last one built that is still alive.
+             */
+            Application& begin_frame();
+            Application& commit();
+
+            /* Instrumentation counters, see Counters */
+            Statistics stats() const;
+
+            /*
+             * Sends frames to the terminal through the given renderer
+             * instead of curses' own doupdate(), or through curses again if
+             * null. The renderer must outlive its use.
+             */
+            Application& render( Renderer* );
+
+            /*
+             * The event loop. run() waits on the terminal and on every
+             * watched file descriptor at once (epoll) and sleeps while
+             * nothing happens. Keys go to the key handler and ready
+             * descriptors to their watchers. Everything that arrives in one
+             * burst is handled before a single frame is drawn by the frame
+             * handler, and frames are drawn at most fps times per second
+             * (0 means no limit). quit() makes run() return once the current
+             * iteration is done.
+             *
+             * When the terminal is resized (KEY_RESIZE) the next frame first
+             * places every attached layout on the whole new screen and calls
+             * the resize handler. Windows are resized and moved in place,
+             * and all of it reaches the terminal in that one frame.
+             */
+            Application();
+            ~Application();
+
+            /*
+             * Runs on the given streams instead of the controlling terminal,
+             * as the given terminal type ($TERM when null). Meant for
+             * headless use such as tests and benchmarks.
+             */
+            Application( FILE* out, FILE* in, const char* term = nullptr );
+
+            Application& on_key( std::function< void( int ) > );
+            Application& on_frame( std::function< void() > );
+            Application& on_resize( std::function< void() > );
+            Application& watch( int fd, std::function< void( int ) > );
+            Application& unwatch( int fd );
+            Application& fps( unsigned int );
+            Application& request_frame();
+
+            /* Drains the channel at the start of every frame */
+            Application& attach( Channel& );
+
+            /* Places the layout on the screen and updates it every frame */
+            Application& attach( Layout& );
+
+            /* Routes mouse events and arrow keys to the index first */
+            Application& attach( SpatialIndex& );
+            Application& mouse( const bool enable = true );
+
+            void run();
+            void quit();
+
+            /*
+             * One-shot callbacks from the event loop. after() calls f once
+             * the time has passed, and next_key() gives f the next key,
+             * which then goes to nothing else (a resize still resizes).
+             * Both return an id for cancel(). Timers are kept in a heap by
+             * deadline, and run() sleeps until the first one is due.
+             */
+            typedef unsigned long Wait;
+
+            Wait after( std::chrono::milliseconds, std::function< void() > f );
+            Wait next_key( std::function< void( int ) > f );
+            void cancel( Wait );
+
+#if __cplusplus >= 202002L
+            class KeyPress;
+            class Sleep;
+
+            /* Awaitables for tasks, see Task */
+            KeyPress key();
+            Sleep sleep( std::chrono::milliseconds );
+
+            /*
+             * Starts the task, which runs until it first waits, and frees
+             * it once it is done. Tasks still waiting when the Application
+             * is destroyed are destroyed with it.
+             */
+            template< typename T >
+                void spawn( Task< T > );
+#endif
+
+        private:
+            class Screen {
+                public:
+                    Screen();
+                    Screen( FILE* out, FILE* in, const char* term );
+                    ~Screen();
+                    /* This wrapper class makes sure the curses initialization
+                     * happens before any members tries to create and draw
+                     * their windows.
+                     */
+
+                private:
+                    SCREEN* term;
+            };
+            Screen screen;
+
+            int input;
+            int poller;
+            bool running = false;
+            bool frame_pending = false;
+            bool resized = false;
+            int frame_depth = 0;
+            std::chrono::steady_clock::duration interval;
+            std::chrono::steady_clock::time_point next_frame;
+
+            std::function< void( int ) > key_handler;
+            std::function< void() > frame_handler;
+            std::function< void() > resize_handler;
+            std::map< int, std::function< void( int ) > > watchers;
+            std::vector< Channel* > channels;
+            std::vector< Layout* > layouts;
+            std::vector< SpatialIndex* > indexes;
+
+            /* timers by deadline; a cancelled one stays in the heap until due */
+            struct Deadline {
+                std::chrono::steady_clock::time_point when;
+                Wait id;
+
+                static bool later( const Deadline&, const Deadline& );
+            };
+
+            Wait waits = 0;
+            std::vector< Deadline > deadlines;
+            std::unordered_map< Wait, std::function< void() > > alarms;
+            std::vector< std::pair< Wait, std::function< void( int ) > > >
+                key_waits, waking;
+
+            /* the frames of spawned tasks, and how to destroy them; the
+             * first exception one of them failed with, for run() */
+            std::unordered_map< void*, void (*)( void* ) > tasks;
+            std::exception_ptr failure;
+
+            void listen();
+            void read_keys();
+            void resize();
+            void frame();
+            void expire();
+            int until_due();
+            void adopt( void* frame, void (*destroy)( void* ) );
+            void release( void* frame );
+            void fail( std::exception_ptr );
+
+#if __cplusplus >= 202002L
+            template< typename T > friend class Task;
+#endif
+
+            /* trigger compile error */
+            Application& operator=( const Application& );
+            Application( const Application& );
+    };
+
+
+    /*
+     * Scoped frame: begins a frame on construction and commits it when it
+     * goes out of scope.
+     */
+    class Frame {
+        public:
+            Frame( Application& );
+            ~Frame();
+
+        private:
+            Application& app;
+
+            /* trigger compile error */
+            Frame& operator=( const Frame& );
+            Frame( const Frame& );
+    };
+
+    int mid( int A, int B );
+    Anchor mid( const Geometry& child );
+    Anchor mid( const Widget& parent, const Geometry& child );
+
+    /* TEMPLATE IMPLEMENTATIONS */
+
+    /* UTILITIES */
+
+#if __cplusplus >= 201703L
+    /* inline, as curses++.cpp itself may be built as C++11 */
+    inline Text::Text( std::string_view str ) :
+        data_( str.data() ),
+        size_( str.size() )
+    {}
+#endif
+
+    template< typename T >
+        WINDOW* Format::get_win( const T& widget ) {
+            return Format::get_win( widget.get_widget() );
+        }
+
+    /* CONSTRUCTORS */
+    template< typename T >
+        Format::Format( const T& widget, int bitmask ) :
+            win( Format::get_win( widget ) ),
+            bitmask( bitmask )
+    {
+        wattron( this->win, bitmask );
+    }
+
+    template< typename T >
+        Format::Format( const T& widget, const Color& fg ) :
+            Format( widget, fg, Color() )
+    {}
+
+    template< typename T >
+        Format::Format( const T& widget, const Color& fg, const Color& bg ) :
+            win( Format::get_win( widget ) ),
+            bitmask( 0 ),
+            pair( Color::pair( fg, bg ) )
+    {
+        this->set_pair();
+    }
+
+
+    template< typename... Args > 
+        Textfield::Textfield( std::string text, const Args&... args ) :
+            text( std::move( text ) ),
+            index( this->text.data( 0 ), this->text.size() ),
+            widget( Geometry( this->index.lines(), this->index.longest() ),
+                    args... )
+    {
+        this->reflow();
+        this->write();
+    }
+
+    /*
+     * The text is moved into the buffer as a single chunk, so it can be
+     * indexed in one piece from data( 0 ).
+     */
+    template< typename... Args > 
+        Textfield::Textfield( std::string text,
+                const Geometry& g,
+                const Args&... args ):
+            text( std::move( text ) ),
+            index( this->text.data( 0 ), this->text.size() ),
+            widget( g, args... )
+    {
+        this->reflow();
+        this->write();
+    }
+
+    template< typename Parent, typename... Args >
+        Textfield::Textfield( const Parent& p,
+                std::string text,
                 const Args&... args ) :
-            text( text ),
+            text( std::move( text ) ),
+            index( this->text.data( 0 ), this->text.size() ),
             widget( p.get_widget(), args... )
     {
-        this->widget.write( text );
+        this->reflow();
+        this->write();
     }
 
-    template< typename... Args > 
-        Label::Label( const Args&... args ) :
+    template< typename... Args >
+        Scrollback::Scrollback( std::size_t max_lines, std::size_t max_bytes,
+                const Args&... args ) :
+            ring( std::max< std::size_t >( max_lines, 1 ) ),
+            max_bytes( max_bytes ),
+            widget( args... )
+    {}
+
+    template< typename Parent, typename... Args >
+        Scrollback::Scrollback( const Parent& p,
+                std::size_t max_lines, std::size_t max_bytes,
+                const Args&... args ) :
+            ring( std::max< std::size_t >( max_lines, 1 ) ),
+            max_bytes( max_bytes ),
+            widget( p.get_widget(), args... )
+    {}
+
+    template< typename... Args >
+        Table::Table( std::vector< std::string > headings,
+                const Args&... args ) :
+            headings( std::move( headings ) ),
+            widget( args... )
+    {
+        this->init();
+    }
+
+    template< typename Parent, typename... Args >
+        Table::Table( const Parent& p, std::vector< std::string > headings,
+                const Args&... args ) :
+            headings( std::move( headings ) ),
+            widget( p.get_widget(), args... )
+    {
+        this->init();
+    }
+
+    template< typename... Args >
+        Chart::Chart( std::size_t capacity, const Args&... args ) :
+            ring( std::max< std::size_t >( capacity, 1 ) ),
+            widget( args... )
+    {}
+
+    template< typename Parent, typename... Args >
+        Chart::Chart( const Parent& p, std::size_t capacity,
+                const Args&... args ) :
+            ring( std::max< std::size_t >( capacity, 1 ) ),
+            widget( p.get_widget(), args... )
+    {}
+
+    template< typename... Args >
+        Editor::Editor( std::size_t history, const Args&... args ) :
+            history( history ),
+            goal( std::string::npos ),
+            widget( args... )
+    {}
+
+    template< typename Parent, typename... Args >
+        Editor::Editor( const Parent& p, std::size_t history,
+                const Args&... args ) :
+            history( history ),
+            goal( std::string::npos ),
+            widget( p.get_widget(), args... )
+    {}
+
+    template< typename... Args >
+        Selector::Selector( std::string prompt, const Args&... args ) :
+            prompt( std::move( prompt ) ),
+            items( std::make_shared< Items >() ),
             widget( args... )
     {}
 
+    template< typename Parent, typename... Args >
+        Selector::Selector( const Parent& p, std::string prompt,
+                const Args&... args ) :
+            prompt( std::move( prompt ) ),
+            items( std::make_shared< Items >() ),
+            widget( p.get_widget(), args... )
+    {}
+
+    template< typename... Args > 
+        Label::Label( std::string text, const Args&... args ) :
+            widget( std::move( text ), args... )
+    {}
+
     template< typename T >
         template< typename... Args >
-        Button< T >::Button( const std::string& text,
+        Button< T >::Button( std::string text,
                 bool action,
                 const Args&... args ) :
             action( [=]{ return action; } ),
             focus_( &Button< T >::default_focus ),
             unfocus_( &Button< T >::default_unfocus ),
-            widget( text, args... )
+            widget( std::move( text ), args... )
             {}
 
     template< typename T >
         template< typename... Args >
-        Button< T >::Button( const std::string& text,
+        Button< T >::Button( std::string text,
                 bool action,
                 std::function< void(Button< T >&) > focus,
                 std::function< void(Button< T >&) > unfocus,
@@ -433,23 +2234,23 @@ namespace cursesxx {
             action( [=]{ return action; } ),
             focus_( focus ),
             unfocus_( unfocus ),
-            widget( text, args... )
+            widget( std::move( text ), args... )
             {}
 
     template< typename T >
         template< typename Action, typename... Args >
-        Button< T >::Button( const std::string& text,
+        Button< T >::Button( std::string text,
                 const Action& action,
                 const Args&... params ) :
             action( action ),
             focus_( &Button< T >::default_focus ),
             unfocus_( &Button< T >::default_unfocus ),
-            widget( text, params... )
+            widget( std::move( text ), params... )
     {}
 
     template< typename T >
         template< typename Action, typename... Args >
-        Button< T >::Button( const std::string& text,
+        Button< T >::Button( std::string text,
                 const Action& action,
                 std::function< void(Button< T >&) > focus,
                 std::function< void(Button< T >&) > unfocus,
@@ -457,7 +2258,7 @@ namespace cursesxx {
             action( action ),
             focus_( focus ),
             unfocus_( unfocus ),
-            widget( text, params... )
+            widget( std::move( text ), params... )
     {}
 
     /*
@@ -476,7 +2277,39 @@ namespace cursesxx {
 
     template< typename T >
         T Button< T >::trigger() {
-            return this->action();
+            T result = this->action();
+            this->wake( &result );
+            return result;
+        }
+
+    template<>
+        inline void Button< void >::trigger() {
+            this->action();
+            this->wake( nullptr );
+        }
+
+    /*
+     * Anything waiting from now on waits for the next trigger(). A waiter
+     * whose task is destroyed by one woken before it takes itself out of
+     * waking, like a key wait cancelled in Application::read_keys(). A
+     * trigger() from a woken task wakes its own round after this one's.
+     */
+    template< typename T >
+        void Button< T >::wake( const void* result ) {
+            if( this->waiting.empty() ) return;
+
+            const std::size_t first = this->waking.size();
+            for( auto& wait : this->waiting )
+                this->waking.push_back( std::move( wait ) );
+            this->waiting.clear();
+
+            for( std::size_t i = first; i < this->waking.size(); ++i ) {
+                auto wake = std::move( this->waking[ i ].second );
+                this->waking[ i ].second = nullptr;
+                if( wake ) wake( result );
+            }
+
+            this->waking.resize( first );
         }
 
     template< typename T >
@@ -489,6 +2322,57 @@ namespace cursesxx {
             return this->widget.get_widget();
         }
 
+#if __cplusplus >= 202002L
+    template< typename T >
+        Button< T >::Pressed::Pressed( Button& button ) :
+            button( button )
+    {}
+
+    template< typename T >
+        Button< T >::Pressed::~Pressed() {
+            if( !this->waiting ) return;
+
+            auto& waiting = this->button.waiting;
+            auto wait = std::find_if( waiting.begin(), waiting.end(),
+                    [this]( const auto& w ) { return w.first == this; } );
+            if( wait != waiting.end() ) {
+                waiting.erase( wait );
+                return;
+            }
+
+            for( auto& w : this->button.waking )
+                if( w.first == this ) w.second = nullptr;
+        }
+
+    template< typename T >
+        bool Button< T >::Pressed::await_ready() const noexcept {
+            return false;
+        }
+
+    template< typename T >
+        void Button< T >::Pressed::await_suspend( std::coroutine_handle<> task ) {
+            this->button.waiting.emplace_back( this,
+                    [this, task]( const void* result ) {
+                        this->waiting = false;
+                        if constexpr( std::is_void_v< T > ) this->value = true;
+                        else this->value = *static_cast< const T* >( result );
+                        task.resume();
+                    } );
+            this->waiting = true;
+        }
+
+    template< typename T >
+        T Button< T >::Pressed::await_resume() {
+            if constexpr( !std::is_void_v< T > )
+                return std::move( *this->value );
+        }
+
+    template< typename T >
+        typename Button< T >::Pressed Button< T >::pressed() {
+            return Pressed( *this );
+        }
+#endif
+
     template< typename T >
         void Button< T >::default_focus( Button< T >& b ) {
             Format bold( b, A_BOLD );
@@ -499,6 +2383,273 @@ namespace cursesxx {
         void Button< T >::default_unfocus( Button< T >& b ) {
             b.redraw();
         }
+
+    /*
+     * STATIC BUTTON METHODS
+     */
+
+    template< typename B >
+        void BoldFocus::focus( B& b ) {
+            Format bold( b, A_BOLD );
+            b.redraw();
+        }
+
+    template< typename B >
+        void BoldFocus::unfocus( B& b ) {
+            b.redraw();
+        }
+
+    template< typename B >
+        void ReverseFocus::focus( B& b ) {
+            Format reverse( b, A_REVERSE );
+            b.redraw();
+        }
+
+    template< typename B >
+        void ReverseFocus::unfocus( B& b ) {
+            b.redraw();
+        }
+
+    template< typename T >
+        Constant< T >::Constant( T value ) :
+            value( std::move( value ) )
+    {}
+
+    template< typename T >
+        T Constant< T >::operator()() const {
+            return this->value;
+        }
+
+    template< typename Action, typename Style >
+        template< typename... Args >
+        StaticButton< Action, Style >::StaticButton( std::string text,
+                Action action,
+                const Args&... params ) :
+            action( std::move( action ) ),
+            widget( std::move( text ), params... )
+    {}
+
+    template< typename Action, typename Style >
+        void StaticButton< Action, Style >::focus() {
+            Style::focus( *this );
+        }
+
+    template< typename Action, typename Style >
+        void StaticButton< Action, Style >::unfocus() {
+            Style::unfocus( *this );
+        }
+
+    template< typename Action, typename Style >
+        auto StaticButton< Action, Style >::trigger()
+        -> decltype( std::declval< Action& >()() ) {
+            return this->action();
+        }
+
+    template< typename Action, typename Style >
+        void StaticButton< Action, Style >::redraw() {
+            this->widget.redraw();
+        }
+
+    template< typename Action, typename Style >
+        void StaticButton< Action, Style >::place( int y, int x,
+                int height, int width ) {
+            this->widget.place( y, x, height, width );
+        }
+
+    template< typename Action, typename Style >
+        const Widget& StaticButton< Action, Style >::get_widget() const {
+            return this->widget.get_widget();
+        }
+
+    /* SPATIAL INDEX */
+
+    template< typename T >
+        SpatialIndex::Id SpatialIndex::add( const T& widget, Click click ) {
+            const Widget& w = widget.get_widget();
+            const Anchor at = w.position();
+            return this->add( at.y, at.x, w.height(), w.width(),
+                    std::move( click ) );
+        }
+
+    template< typename B >
+        SpatialIndex::Id SpatialIndex::add_focusable( B& button,
+                Click click ) {
+
+            const Widget& w = button.get_widget();
+            const Anchor at = w.position();
+            return this->add( at.y, at.x, w.height(), w.width(),
+                    std::move( click ),
+                    [&button]( bool on ) {
+                        if( on ) button.focus();
+                        else button.unfocus();
+                    } );
+        }
+
+    template< typename T >
+        void SpatialIndex::update( Id id, const T& widget ) {
+            const Widget& w = widget.get_widget();
+            const Anchor at = w.position();
+            this->move( id, at.y, at.x, w.height(), w.width() );
+        }
+
+#if __cplusplus >= 202002L
+    /* TASKS */
+
+    template< typename T >
+        Task< T > Task< T >::promise_type::get_return_object() {
+            return Task( Handle::from_promise( *this ) );
+        }
+
+    /*
+     * A spawned task has nobody to hand its exception to, so the
+     * Application keeps it for run(); throwing it from here would skip
+     * whatever else was being woken up with the task.
+     */
+    template< typename T >
+        void Task< T >::promise_type::unhandled_exception() {
+            if( this->owner ) this->owner->fail( std::current_exception() );
+            else this->error = std::current_exception();
+        }
+
+    /*
+     * A finished task resumes the task awaiting it, which frees it. A
+     * spawned task frees itself.
+     */
+    template< typename T >
+        std::coroutine_handle<> Task< T >::promise_type::Final::await_suspend(
+                std::coroutine_handle< promise_type > task ) noexcept {
+
+            promise_type& promise = task.promise();
+            if( promise.owner ) {
+                promise.owner->release( task.address() );
+                task.destroy();
+                return std::noop_coroutine();
+            }
+
+            if( promise.continuation ) return promise.continuation;
+            return std::noop_coroutine();
+        }
+
+    template< typename T >
+        Task< T >::Task( Handle handle ) :
+            handle( handle )
+    {}
+
+    template< typename T >
+        Task< T >::Task( Task&& other ) noexcept :
+            handle( std::exchange( other.handle, nullptr ) )
+    {}
+
+    template< typename T >
+        Task< T >::~Task() {
+            if( this->handle ) this->handle.destroy();
+        }
+
+    template< typename T >
+        bool Task< T >::await_ready() const noexcept {
+            return false;
+        }
+
+    template< typename T >
+        std::coroutine_handle<> Task< T >::await_suspend(
+                std::coroutine_handle<> awaiting ) noexcept {
+            this->handle.promise().continuation = awaiting;
+            return this->handle;
+        }
+
+    template< typename T >
+        T Task< T >::await_resume() {
+            promise_type& promise = this->handle.promise();
+            if( promise.error ) std::rethrow_exception( promise.error );
+            return promise.take();
+        }
+
+    /*
+     * The awaitables unregister themselves if their task is destroyed while
+     * waiting, so nothing is ever resumed after it is gone.
+     */
+    class Application::KeyPress {
+        public:
+            explicit KeyPress( Application& app ) : app( app ) {}
+            ~KeyPress() { if( this->wait ) this->app.cancel( this->wait ); }
+
+            bool await_ready() const noexcept { return false; }
+
+            void await_suspend( std::coroutine_handle<> task ) {
+                this->wait = this->app.next_key( [this, task]( int key ) {
+                    this->wait = 0;
+                    this->key = key;
+                    task.resume();
+                } );
+            }
+
+            int await_resume() const noexcept { return this->key; }
+
+        private:
+            Application& app;
+            Wait wait = 0;
+            int key = ERR;
+    };
+
+    class Application::Sleep {
+        public:
+            Sleep( Application& app, std::chrono::milliseconds duration ) :
+                app( app ), duration( duration ) {}
+            ~Sleep() { if( this->wait ) this->app.cancel( this->wait ); }
+
+            bool await_ready() const noexcept { return false; }
+
+            void await_suspend( std::coroutine_handle<> task ) {
+                this->wait = this->app.after( this->duration, [this, task] {
+                    this->wait = 0;
+                    task.resume();
+                } );
+            }
+
+            void await_resume() const noexcept {}
+
+        private:
+            Application& app;
+            std::chrono::milliseconds duration;
+            Wait wait = 0;
+    };
+
+    inline Application::KeyPress Application::key() {
+        return KeyPress( *this );
+    }
+
+    inline Application::Sleep Application::sleep(
+            std::chrono::milliseconds duration ) {
+        return Sleep( *this, duration );
+    }
+
+    template< typename T >
+        void Application::spawn( Task< T > task ) {
+            typename Task< T >::Handle handle =
+                std::exchange( task.handle, nullptr );
+
+            handle.promise().owner = this;
+            this->adopt( handle.address(), []( void* frame ) {
+                std::coroutine_handle<>::from_address( frame ).destroy();
+            } );
+            handle.resume();
+        }
+#endif
+
+    /* LAYOUT */
+
+    template< typename T >
+        std::size_t Layout::add( T& item, const Constraint& constraint ) {
+            Item entry( constraint );
+            entry.place = [&item]( int y, int x, int height, int width ) {
+                item.place( y, x, height, width );
+                item.redraw();
+            };
+
+            this->items.push_back( std::move( entry ) );
+            this->mark();
+            return this->items.size() - 1;
+        }
 }
 
 #endif //CURSESXX_APPLICATION
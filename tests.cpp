@@ -0,0 +1,1124 @@
+/*
+ * Headless tests for curses++.
+ *
+ * Like the benchmarks, curses runs through newterm() with a fixed terminal
+ * type and size and writes into an anonymous temporary file. Frames go to a
+ * Renderer without a descriptor, which keeps what the terminal would show,
+ * so every test reads the screen back cell by cell. Each test prints ok or
+ * FAIL with what went wrong, and the exit status is the number of failures.
+ *
+ * Build and run:
+ *
+ *     g++ -std=c++11 tests.cpp curses++.cpp -o tests -lpanelw -lncursesw -pthread
+ *     ./tests
+ *
+ * The tests for tasks need C++20, and are left out of older builds.
+ */
+
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include "curses++.h"
+
+using namespace cursesxx;
+
+namespace {
+
+    const char* const terminal = "xterm-256color";
+    const int lines = 24;
+    const int cols = 80;
+
+    int failures = 0;
+    bool passed = true;
+
+    void check( bool condition, const char* what ) {
+        if( condition ) return;
+        std::printf( "    %s\n", what );
+        passed = false;
+    }
+
+    template< typename Test >
+        void run( const char* name, Test test ) {
+            passed = true;
+            test();
+            std::printf( "%-60s %s\n", name, passed ? "ok" : "FAIL" );
+            if( !passed ) ++failures;
+        }
+
+    /* Row y of the screen, from column x on */
+    std::string at( const Renderer& screen, int y, int x ) {
+        return screen.line( y ).substr( x );
+    }
+
+    bool starts( const std::string& s, const char* prefix ) {
+        return s.compare( 0, std::string( prefix ).size(), prefix ) == 0;
+    }
+
+    /*
+     * Redraws inside a frame are held back until the outermost commit(),
+     * and a commit() without a frame changes nothing.
+     */
+    void frames( Application& app, const Renderer& screen ) {
+        Widget widget( Geometry( 1, 20 ), Anchor( 20, 0 ) );
+
+        app.begin_frame();
+        app.begin_frame();
+        widget.write( "framed", 6, 0, 0 );
+        widget.redraw();
+        app.commit();
+
+        check( !starts( at( screen, 20, 0 ), "framed" ),
+                "a redraw reached the screen inside a frame" );
+
+        app.commit();
+        check( starts( at( screen, 20, 0 ), "framed" ),
+                "the outermost commit did not flush the frame" );
+
+        app.commit();
+        app.begin_frame();
+        widget.write( "held", 4, 0, 0 );
+        widget.redraw();
+
+        check( !starts( at( screen, 20, 0 ), "held" ),
+                "an unbalanced commit() ended a later frame" );
+
+        app.commit();
+        check( starts( at( screen, 20, 0 ), "held" ),
+                "the frame after an unbalanced commit() was not flushed" );
+    }
+
+    /*
+     * A child is a view into its parent's window. What it draws has to
+     * reach the screen even when the parent redraws after it in the same
+     * frame.
+     */
+    void child_then_parent( Application& app, const Renderer& screen ) {
+        Widget parent( Geometry( 4, 30 ), Anchor( 2, 2 ) );
+        Widget child( parent, Geometry( 1, 10 ), Anchor( 1, 4 ) );
+
+        app.begin_frame();
+        parent.write( "parent", 6, 0, 0 );
+        parent.redraw();
+        app.commit();
+
+        app.begin_frame();
+        child.write( "child", 5, 0, 0 );
+        child.redraw();
+        parent.write( "PARENT", 6, 0, 0 );
+        parent.redraw();
+        app.commit();
+
+        check( starts( at( screen, 3, 6 ), "child" ),
+                "the child's cells were lost when the parent redrew" );
+        check( starts( at( screen, 2, 2 ), "PARENT" ),
+                "the parent's cells did not reach the screen" );
+
+        /* and with the parent having drawn first */
+        app.begin_frame();
+        parent.write( "parent", 6, 0, 0 );
+        child.write( "CHILD", 5, 0, 0 );
+        child.redraw();
+        parent.redraw();
+        app.commit();
+
+        check( starts( at( screen, 3, 6 ), "CHILD" ),
+                "the child's cells were lost after the parent drew first" );
+    }
+
+    /* Waits for something to be posted to the channel */
+    bool posted( const Channel& channel ) {
+        pollfd event = { channel.fd(), POLLIN, 0 };
+        return poll( &event, 1, 5000 ) == 1;
+    }
+
+    /*
+     * Posts under one key collapse to the last one made before the drain;
+     * posts without a key are all applied, in the order they were made.
+     * drain() returns how many were applied.
+     */
+    void channel_updates( Application& app, const Renderer& screen ) {
+        Channel channel;
+
+        int value = 0;
+        channel.post( &value, [&value] { value = 1; } );
+        channel.post( &value, [&value] { value = 2; } );
+        channel.post( &value, [&value] { value = 3; } );
+
+        check( channel.drain() == 1, "keyed posts were not collapsed" );
+        check( value == 3, "the last keyed post was not the one applied" );
+
+        std::string order;
+        for( char c : std::string( "abcde" ) )
+            channel.post( [&order, c] { order += c; } );
+
+        check( channel.drain() == 5, "unkeyed posts were not all applied" );
+        check( order == "abcde", "unkeyed posts were applied out of order" );
+
+        /* the last write is applied in its place, after the first append */
+        Textfield status( "", Geometry( 1, 40 ), Anchor( 21, 0 ) );
+        channel.write( status, "stale" );
+        channel.append( status, "lost" );
+        channel.write( status, "one " );
+        channel.append( status, "two " );
+        channel.append( status, "three" );
+
+        app.begin_frame();
+        check( channel.drain() == 4, "a drain did not count what it applied" );
+        app.commit();
+
+        check( starts( at( screen, 21, 0 ), "one two three " ),
+                "the textfield does not show the last write and what follows" );
+        check( channel.drain() == 0, "an empty drain applied something" );
+    }
+
+    /* Posts from several threads at once all arrive, each thread's in order */
+    void channel_producers() {
+        const int threads = 4;
+        const int posts = 20000;
+
+        Channel channel;
+        std::vector< int > next( threads, 0 );
+        bool ordered = true;
+
+        std::vector< std::thread > producers;
+        for( int t = 0; t < threads; ++t ) {
+            producers.emplace_back( [&, t] {
+                for( int i = 0; i < posts; ++i )
+                    channel.post( [&, t, i] {
+                        if( next[ t ]++ != i ) ordered = false;
+                    } );
+            } );
+        }
+
+        std::size_t applied = 0;
+        while( applied < std::size_t( threads * posts ) && posted( channel ) )
+            applied += channel.drain();
+
+        for( std::thread& producer : producers ) producer.join();
+        applied += channel.drain();
+
+        check( applied == std::size_t( threads * posts ),
+                "posts were lost or applied twice" );
+        check( ordered, "a thread's posts were applied out of order" );
+    }
+
+    /*
+     * More colour combinations than the 8 bits COLOR_PAIR() holds: every
+     * cell has to keep a pair of its own colours, not one masked down to
+     * another pair.
+     */
+    void many_pairs( Application& app, const Renderer& screen ) {
+        if( COLOR_PAIRS <= 256 ) {
+            check( false, "the terminal has no more than 256 pairs" );
+            return;
+        }
+
+        static const int levels[] = { 0, 95, 135, 175, 215, 255 };
+        Widget widget( Geometry( 8, 60 ), Anchor( 10, 0 ) );
+
+        app.begin_frame();
+        for( int n = 0; n < 432; ++n ) {
+            const Color fg( levels[ n % 6 ], levels[ n / 6 % 6 ],
+                    levels[ n / 36 % 6 ] );
+            const Color bg = n < 216 ? Color( 0, 0, 0 ) : Color( 255, 255, 255 );
+
+            Format colour( widget, fg, bg );
+            widget.write( "x", 1, n / 60, n % 60 );
+        }
+        widget.redraw();
+        app.commit();
+
+        int kept = 0;
+        for( int n = 0; n < 432; ++n ) {
+            const int pair = screen.pair( 10 + n / 60, n % 60 );
+            const int fg = 16 + 36 * ( n % 6 ) + 6 * ( n / 6 % 6 ) + n / 36 % 6;
+            const int bg = n < 216 ? 16 : 231;
+
+            int f, b;
+            if( pair > 0 && extended_pair_content( pair, &f, &b ) != ERR
+                    && f == fg && b == bg )
+                ++kept;
+        }
+
+        check( kept == 432, "cells lost their colour pairs" );
+    }
+
+    /*
+     * A widget a layout can place, filled with one letter so the screen
+     * shows where it went, and counting how often it was placed.
+     */
+    struct Tile {
+        explicit Tile( char letter ) :
+            letter( letter ),
+            widget( Geometry( 1, 1 ), Anchor( 0, 0 ) )
+        {}
+
+        void place( int y, int x, int height, int width ) {
+            this->widget.place( y, x, height, width );
+            ++this->placed;
+        }
+
+        void redraw() {
+            const std::string fill( this->widget.width(), this->letter );
+            for( int y = 0; y < this->widget.height(); ++y )
+                this->widget.write( fill.data(), fill.size(), y, 0 );
+            this->widget.redraw();
+        }
+
+        char letter;
+        int placed = 0;
+        Widget widget;
+    };
+
+    std::string repeat( char c, int n ) {
+        return std::string( n, c );
+    }
+
+    /*
+     * Free space is shared by weight on top of every item's minimum, within
+     * its maximum, inside the padding.
+     */
+    void layout_sizes( Application& app, const Renderer& screen ) {
+        Tile a( 'a' ), b( 'b' ), c( 'c' );
+
+        Layout layout( Layout::row );
+        layout.add( a, Constraint( 1 ) );
+        layout.add( b, Constraint( 2 ) );
+        layout.add( c, Constraint( 1, 10 ) );
+        layout.padding( 1 );
+        layout.place( 12, 0, 3, 62 );
+
+        app.begin_frame();
+        layout.update();
+        app.commit();
+
+        /* 50 free cells: a gets 50/4, b 38*2/3, and c the rest on its 10 */
+        check( at( screen, 13, 0 ).substr( 0, 62 ) == " " + repeat( 'a', 12 )
+                + repeat( 'b', 25 ) + repeat( 'c', 23 ) + " ",
+                "the row was not split by weight and minimum" );
+        check( at( screen, 12, 0 ).substr( 0, 62 ) == repeat( ' ', 62 )
+                && at( screen, 14, 0 ).substr( 0, 62 ) == repeat( ' ', 62 ),
+                "the padding above and below the row was drawn over" );
+
+        Tile d( 'd' ), e( 'e' );
+        Layout column( Layout::column );
+        column.add( d, Constraint( 1, 0, 1 ) );
+        column.add( e, Constraint( 1, 0, 2 ) );
+        column.place( 12, 70, 10, 4 );
+
+        app.begin_frame();
+        column.update();
+        app.commit();
+
+        check( d.widget.height() == 1 && e.widget.height() == 2,
+                "a column item is taller than its maximum" );
+        check( at( screen, 12, 70 ).substr( 0, 4 ) == "dddd"
+                && at( screen, 13, 70 ).substr( 0, 4 ) == "eeee"
+                && at( screen, 14, 70 ).substr( 0, 4 ) == "eeee",
+                "the column items are not stacked from the top" );
+    }
+
+    /* Space a capped item cannot take goes to the items after it */
+    void layout_capped( Application& app, const Renderer& screen ) {
+        Tile a( 'a' ), b( 'b' ), c( 'c' );
+
+        Layout layout( Layout::row );
+        layout.add( a, Constraint( 1, 0, 5 ) );
+        layout.add( b );
+        layout.add( c );
+        layout.place( 16, 0, 1, 60 );
+
+        app.begin_frame();
+        layout.update();
+        app.commit();
+
+        check( at( screen, 16, 0 ).substr( 0, 60 ) == repeat( 'a', 5 )
+                + repeat( 'b', 27 ) + repeat( 'c', 28 ),
+                "the space left over by a capped item was not passed on" );
+    }
+
+    /* update() only lays out and places again what changed */
+    void layout_incremental( Application& app, const Renderer& screen ) {
+        Tile a( 'a' ), b( 'b' ), c( 'c' ), d( 'd' );
+
+        Layout layout( Layout::row );
+        Layout& left = layout.nest( Layout::column );
+        Layout& right = layout.nest( Layout::column );
+        left.add( a );
+        left.add( b );
+        right.add( c );
+        right.add( d );
+        layout.place( 18, 0, 4, 40 );
+
+        app.begin_frame();
+        layout.update();
+        app.commit();
+
+        check( a.placed == 1 && b.placed == 1 && c.placed == 1 && d.placed == 1,
+                "the first update did not place every item once" );
+
+        layout.update();
+        check( a.placed == 1 && c.placed == 1,
+                "an update with nothing changed placed items again" );
+
+        right.constrain( 0, Constraint( 1, 0, 1 ) );
+
+        app.begin_frame();
+        layout.update();
+        app.commit();
+
+        check( a.placed == 1 && b.placed == 1,
+                "items of a layout that did not change were placed again" );
+        check( c.placed == 2 && d.placed == 2,
+                "items of the changed layout were not placed again" );
+        check( at( screen, 18, 0 ).substr( 0, 40 ) == repeat( 'a', 20 )
+                + repeat( 'c', 20 )
+                && at( screen, 19, 0 ).substr( 0, 40 ) == repeat( 'a', 20 )
+                + repeat( 'd', 20 )
+                && at( screen, 21, 0 ).substr( 0, 40 ) == repeat( 'b', 20 )
+                + repeat( 'd', 20 ),
+                "the screen does not show the layout after the change" );
+    }
+
+    /* The characters in column x of the n rows from row y down */
+    std::string down( const Renderer& screen, int y, int x, int n ) {
+        std::string column;
+        for( int row = y; row < y + n; ++row )
+            column += at( screen, row, x ).substr( 0, 1 );
+        return column;
+    }
+
+    /*
+     * Applies what a table's or selector's worker posts until its latest
+     * sort, filter or search is swapped in. Returns whether it was.
+     */
+    template< typename Worked >
+        bool settle( Application& app, Channel& channel, const Worked& w ) {
+            while( w.busy() && posted( channel ) ) {
+                app.begin_frame();
+                channel.drain();
+                app.commit();
+            }
+
+            return !w.busy();
+        }
+
+    /* The keys of the table tests, and the rows they are in */
+    void fill( Table& table ) {
+        const char* const keys[] = { "10", "x", "9", "-1.5", "abc", "ab", "9" };
+        const char* const ids[] = { "a", "b", "c", "d", "e", "f", "g" };
+
+        for( int row = 0; row < 7; ++row )
+            table.add( { Text( keys[ row ] ), Text( ids[ row ] ) } );
+    }
+
+    /*
+     * Numbers sort as numbers ahead of text, text bytewise, and equal keys
+     * keep the order their rows were added in. The screen only shows the
+     * new order once it is swapped in.
+     */
+    void table_order( Application& app, const Renderer& screen ) {
+        Channel channel;
+        Table table( { "k", "id" }, Geometry( 8, 20 ), Anchor( 12, 0 ) );
+        table.notify( channel );
+        fill( table );
+
+        app.begin_frame();
+        table.redraw();
+        app.commit();
+        check( down( screen, 13, 5, 7 ) == "abcdefg",
+                "the rows are not shown in the order they were added" );
+
+        table.sort( 0 );
+        check( down( screen, 13, 5, 7 ) == "abcdefg",
+                "the sorted order was shown before it was swapped in" );
+        check( settle( app, channel, table ), "the sort was not swapped in" );
+        check( down( screen, 13, 5, 7 ) == "dcgafeb",
+                "ascending: not numbers by value, then text bytewise" );
+        check( starts( at( screen, 13, 0 ), "-1.5 d" ),
+                "the first row is not the smallest number" );
+
+        table.sort( 0, true );
+        check( settle( app, channel, table ), "the sort was not swapped in" );
+        check( down( screen, 13, 5, 7 ) == "befacgd",
+                "descending: not text, then numbers, equal keys in order" );
+        check( table.row_at( 0 ) == 1 && table.row_at( 6 ) == 3,
+                "row_at() does not follow the order on screen" );
+    }
+
+    /*
+     * Filtering keeps the rows whose cell contains the text. Rows added
+     * after a sort or filter was asked for follow the rows it ordered, if
+     * they pass the filter.
+     */
+    void table_filter( Application& app, const Renderer& screen ) {
+        Channel channel;
+        Table table( { "k", "id" }, Geometry( 8, 20 ), Anchor( 12, 0 ) );
+        table.notify( channel );
+        fill( table );
+
+        table.sort( 0 );
+        table.filter( 0, "9" );
+        check( settle( app, channel, table ), "the filter was not swapped in" );
+        check( table.listed() == 2 && table.row_at( 0 ) == 2
+                && table.row_at( 1 ) == 6,
+                "the filtered rows are not the ones containing the text" );
+        check( down( screen, 13, 5, 3 ) == "cg ",
+                "the rows filtered out are still on screen" );
+
+        table.filter( 0, "a" );
+        table.add( { Text( "0a" ), Text( "h" ) } );
+        table.add( { Text( "1" ), Text( "i" ) } );
+        check( settle( app, channel, table ), "the filter was not swapped in" );
+        check( table.rows() == 9 && table.listed() == 3,
+                "rows added after the filter was asked for are miscounted" );
+        check( down( screen, 13, 5, 4 ) == "feh ",
+                "a row added after the snapshot does not follow the others" );
+
+        table.filter( Table::none, "" );
+        check( settle( app, channel, table ), "the filter was not swapped in" );
+        check( table.listed() == 9, "clearing the filter lost rows" );
+        check( down( screen, 13, 5, 7 ) == "dicgahf",
+                "the rows are not sorted once the filter is cleared" );
+    }
+
+    /*
+     * A column is as wide as its widest cell, and narrows when that cell
+     * is changed or a narrower one takes its place.
+     */
+    void table_widths( Application& app, const Renderer& screen ) {
+        Table table( { "k", "id" }, Geometry( 8, 20 ), Anchor( 12, 0 ) );
+        fill( table );
+        check( table.width( 0 ) == 4, "the key column is not 4 wide" );
+
+        table.set( 3, 0, "1" );
+        check( table.width( 0 ) == 3,
+                "the column did not narrow to the next widest cell" );
+
+        table.set( 4, 0, "q" );
+        check( table.width( 0 ) == 2,
+                "the column did not narrow again when its widest went" );
+
+        app.begin_frame();
+        table.redraw();
+        app.commit();
+        check( starts( at( screen, 13, 0 ), "10 a" )
+                && starts( at( screen, 16, 0 ), "1  d" ),
+                "the screen does not show the narrower column" );
+
+        table.set( 0, 0, "longer" );
+        check( table.width( 0 ) == 6, "the column did not widen" );
+
+        table.set( 0, 0, "s" );
+        check( table.width( 0 ) == 2,
+                "an edit in place left the column too wide" );
+        check( table.width( 1 ) == 2,
+                "the id column is not as wide as its heading" );
+    }
+
+    /* n items for the selector tests, the same for the same seed */
+    std::vector< std::string > words( std::size_t n, unsigned seed ) {
+        const char alphabet[] = "abcdefgh_/ABCD";
+        std::vector< std::string > items( n );
+
+        for( std::string& item : items ) {
+            seed = seed * 1103515245 + 12345;
+            item.resize( 4 + ( seed >> 16 ) % 12 );
+
+            for( char& c : item ) {
+                seed = seed * 1103515245 + 12345;
+                c = alphabet[ ( seed >> 16 ) % ( sizeof( alphabet ) - 1 ) ];
+            }
+        }
+
+        return items;
+    }
+
+    /* Whether two selectors list the same matches, in the same order */
+    bool same( const Selector& a, const Selector& b ) {
+        if( a.matched() != b.matched() || a.listed() != b.listed() )
+            return false;
+
+        for( std::size_t i = 0; i < a.listed(); ++i )
+            if( a.item_at( i ) != b.item_at( i ) ) return false;
+
+        return true;
+    }
+
+    /* The match count on the right of the selector's first row */
+    std::string counted( const Selector& selector ) {
+        return " " + std::to_string( selector.matched() ) + "/"
+            + std::to_string( selector.size() );
+    }
+
+    /*
+     * A search from a fresh selector over the same items, so nothing is
+     * refined: the matches a refined query has to come up with. The channel
+     * has to outlive the selector.
+     */
+    void rescan( Application& app, Channel& channel, Selector& fresh,
+            unsigned threads, const std::vector< std::string >& items,
+            const std::string& query ) {
+        fresh.threads( threads );
+        fresh.notify( channel );
+        fresh.add( items );
+        fresh.search( query );
+        check( settle( app, channel, fresh ), "the rescan was not swapped in" );
+    }
+
+    /*
+     * Typing further, and deleting, only searches the matches of an earlier
+     * query and the items added since, in chunks over several threads. It
+     * has to find exactly what searching every item does.
+     */
+    void selector_refine( Application& app, const Renderer& screen,
+            unsigned threads ) {
+        std::vector< std::string > items = words( 40000, 1 );
+        const std::vector< std::string > more = words( 20000, 2 );
+
+        Channel channel;
+        Selector selector( "> ", Geometry( 6, 40 ), Anchor( 12, 0 ) );
+        selector.threads( threads );
+        selector.notify( channel );
+        selector.add( items );
+
+        const int keys[] = { 'a', 'b', 'c', 0, 'h', KEY_BACKSPACE, 'd' };
+        for( int key : keys ) {
+            if( key == 0 ) {
+                selector.add( more );
+                items.insert( items.end(), more.begin(), more.end() );
+                continue;
+            }
+
+            selector.key( key );
+            check( settle( app, channel, selector ),
+                    "the search was not swapped in" );
+
+            Channel scanned;
+            Selector fresh( "> ", Geometry( 6, 40 ), Anchor( 12, 40 ) );
+            rescan( app, scanned, fresh, threads, items, selector.query() );
+
+            if( !same( selector, fresh ) ) {
+                check( false, ( "refining to " + selector.query()
+                            + " found other matches" ).c_str() );
+                return;
+            }
+        }
+
+        app.begin_frame();
+        selector.redraw();
+        app.commit();
+
+        const std::string status = at( screen, 12, 0 ).substr( 0, 40 );
+        check( starts( status, "> abcd" ) && status.size() == 40
+                && status.compare( 40 - counted( selector ).size(),
+                    std::string::npos, counted( selector ) ) == 0,
+                "the first row does not show the query and its count" );
+        check( selector.matched() > 0 && selector.listed() > 0,
+                "the last query matched nothing, so proved nothing" );
+    }
+
+    /*
+     * A search overtaken by a later one is never swapped in, whether it is
+     * cancelled part way or done and posted already: what is listed is
+     * only ever all the items or the matches of the last query.
+     */
+    void selector_superseded( Application& app, const Renderer& screen,
+            unsigned threads ) {
+        const std::vector< std::string > items = words( 60000, 3 );
+
+        Channel scanned;
+        Selector first( "> ", Geometry( 6, 40 ), Anchor( 12, 40 ) );
+        rescan( app, scanned, first, threads, items, "abc" );
+        Selector last( "> ", Geometry( 6, 40 ), Anchor( 12, 40 ) );
+        rescan( app, scanned, last, threads, items, "hg" );
+        check( first.matched() != last.matched(),
+                "the two queries match as many items, so prove nothing" );
+
+        Channel channel;
+        Selector selector( "> ", Geometry( 6, 40 ), Anchor( 12, 0 ) );
+        selector.threads( threads );
+        selector.notify( channel );
+        selector.add( items );
+
+        auto overtaken = [&] {
+            return selector.matched() != selector.size()
+                && !same( selector, last );
+        };
+
+        selector.search( "abc" );
+        check( posted( channel ), "the first search did not post a redraw" );
+        selector.search( "hg" );
+
+        app.begin_frame();
+        channel.drain();
+        app.commit();
+        check( !overtaken(), "a finished, superseded search was swapped in" );
+
+        selector.search( "a" );
+        selector.search( "ab" );
+        selector.search( "abc" );
+        selector.search( "hg" );
+
+        while( selector.busy() && posted( channel ) ) {
+            app.begin_frame();
+            channel.drain();
+            app.commit();
+
+            if( overtaken() ) break;
+        }
+
+        check( !overtaken(), "a cancelled search was swapped in" );
+        check( !selector.busy() && same( selector, last ),
+                "the last search was not swapped in" );
+
+        const std::string status = at( screen, 12, 0 ).substr( 0, 40 );
+        check( status.compare( 40 - counted( last ).size(),
+                    std::string::npos, counted( last ) ) == 0,
+                "the first row does not count the last query's matches" );
+    }
+
+    /* The column of the first cell in reverse on row y, or -1 */
+    int reversed( const Renderer& screen, int y ) {
+        for( int x = 0; x < cols; ++x )
+            if( screen.cell( y, x ) & A_REVERSE ) return x;
+        return -1;
+    }
+
+    /*
+     * The Editor keeps the cursor's column as keys come in, a byte at a
+     * time for UTF-8, and as it moves and erases around wide characters.
+     */
+    void editor_cursor( Application& app, const Renderer& screen ) {
+        Editor editor( 10, Geometry( 1, 20 ), Anchor( 20, 0 ) );
+        editor.focus();
+
+        const int at = reversed( screen, 20 );
+        auto typed = [&]( std::initializer_list< int > keys ) {
+            for( int key : keys ) editor.key( key );
+            app.begin_frame();
+            editor.redraw();
+            app.commit();
+            return reversed( screen, 20 );
+        };
+
+        check( at == 0, "the cursor does not start in the first column" );
+        check( typed( { 'a', 0xC3, 0xA9, 0xE4, 0xB8, 0xAD, 'b' } ) == 5,
+                "the cursor is not after a, e acute, a wide character, b" );
+        check( typed( { KEY_LEFT, KEY_LEFT } ) == 2,
+                "stepping back over a wide character" );
+        check( typed( { KEY_BACKSPACE } ) == 1,
+                "erasing the character before a wide one" );
+        check( typed( { KEY_END } ) == 4, "moving to the end of the line" );
+        check( typed( { KEY_HOME, KEY_RIGHT, KEY_RIGHT } ) == 3,
+                "stepping over a wide character" );
+    }
+
+    /* Words to complete from, some of them parting inside a character */
+    void vocabulary( Trie& trie ) {
+        const char* const words[] = {
+            "grep", "git-config", "go", "git", "gofmt", "git-commit",
+            "h\xC3\xA9lium", "h\xC3\xA9llo", "x\xC3\xA9", "x\xC3\xA8",
+        };
+
+        for( const char* word : words ) trie.add( word );
+    }
+
+    std::string joined( const std::vector< std::string >& words ) {
+        std::string all;
+        for( const std::string& word : words ) all += word + " ";
+        return all;
+    }
+
+    /*
+     * Words come out in byte order, as many as asked for. The common
+     * continuation goes as far as every word agrees, stopping at a word
+     * that ends there and before a character the words part inside.
+     */
+    void trie_complete() {
+        Trie trie;
+        vocabulary( trie );
+
+        check( trie.size() == 10 && !trie.add( "git" ),
+                "a word was counted twice" );
+        check( trie.contains( "go" ) && !trie.contains( "gi" ),
+                "contains() is not only true for whole words" );
+
+        std::vector< std::string > out( 5, "stale" );
+        check( trie.complete( "g", 10, out ) == 6 && joined( out )
+                == "git git-commit git-config go gofmt grep ",
+                "the words starting with g are not all there, in order" );
+        check( trie.complete( "git-", 1, out ) == 1
+                && joined( out ) == "git-commit ",
+                "the limit did not stop at the first word in order" );
+        check( trie.complete( "z", 10, out ) == 0 && out.empty(),
+                "words were found for a prefix nothing starts with" );
+
+        check( trie.common( "gi" ) == "t",
+                "the continuation went past a word that ends there" );
+        check( trie.common( "git-c" ) == "o",
+                "the continuation did not stop where the words part" );
+        check( trie.common( "gr" ) == "ep",
+                "the continuation of the only word was not all of it" );
+        check( trie.common( "h" ) == "\xC3\xA9l",
+                "the continuation over a shared character was cut short" );
+        check( trie.common( "x" ).empty(),
+                "the continuation ended inside a character" );
+        check( trie.common( "go" ).empty() && trie.common( "z" ).empty(),
+                "a word, or nothing, was continued" );
+    }
+
+    /*
+     * Tab completes the word before the cursor as far as the words agree,
+     * and suggestions() lists what it could become, in order.
+     */
+    void editor_completion( Application& app, const Renderer& screen ) {
+        Trie trie;
+        vocabulary( trie );
+
+        Editor editor( 10, Geometry( 1, 30 ), Anchor( 20, 0 ) );
+        editor.completions( &trie );
+        std::vector< std::string > out;
+
+        auto typed = [&]( const char* keys ) {
+            for( const char* key = keys; *key; ++key ) editor.key( *key );
+            app.begin_frame();
+            editor.redraw();
+            app.commit();
+            return editor.text();
+        };
+
+        check( typed( "gi\t" ) == "git" && starts( at( screen, 20, 0 ),
+                    "git " ),
+                "Tab did not complete gi to git" );
+        check( editor.suggestions( 10, out ) == 3 && joined( out )
+                == "git git-commit git-config ",
+                "the suggestions for git are not in order" );
+
+        check( typed( "-c\t" ) == "git-co" && starts( at( screen, 20, 0 ),
+                    "git-co " ),
+                "Tab did not complete as far as the words agree" );
+        check( editor.suggestions( 10, out ) == 2 && joined( out )
+                == "git-commit git-config ",
+                "the suggestions did not narrow with the word" );
+
+        check( typed( " g\t" ) == "git-co g",
+                "Tab went past where the words part" );
+        check( editor.suggestions( 2, out ) == 2
+                && joined( out ) == "git git-commit ",
+                "the suggestions are not for the word before the cursor" );
+
+        check( typed( "z\t" ) == "git-co gz" && editor.suggestions( 10, out )
+                == 0, "a word nothing starts with was completed" );
+    }
+
+    /*
+     * Up and Down step through the last entries submitted, and back to
+     * what was being typed. Typing over an entry makes it the new draft.
+     */
+    void editor_history( Application& app, const Renderer& screen ) {
+        Editor editor( 3, Geometry( 1, 30 ), Anchor( 20, 0 ) );
+        std::vector< std::string > submitted;
+        editor.on_submit( [&]( const std::string& text ) {
+            submitted.push_back( text );
+        } );
+
+        auto shown = [&]( int key ) {
+            if( key ) editor.key( key );
+            app.begin_frame();
+            editor.redraw();
+            app.commit();
+
+            const std::string text = editor.text();
+            const bool on_screen = at( screen, 20, 0 ).substr( 0, 30 )
+                == text + std::string( 30 - text.size(), ' ' );
+            return on_screen && editor.cursor() == text.size()
+                ? text
+                : "(" + text + " not shown, or the cursor not at its end)";
+        };
+
+        const char* const entries[] = {
+            "one", "two", "two", "", "three", "four",
+        };
+
+        for( const char* entry : entries ) {
+            editor.set( entry );
+            editor.key( '\n' );
+        }
+
+        check( submitted.size() == 6 && shown( 0 ).empty(),
+                "submitting did not pass on the text and empty the editor" );
+
+        editor.insert( "dra" );
+        check( shown( KEY_UP ) == "four", "Up did not recall the newest" );
+        check( shown( KEY_UP ) == "three",
+                "an empty or repeated entry went into the history" );
+        check( shown( KEY_UP ) == "two", "Up did not step back" );
+        check( shown( KEY_UP ) == "two",
+                "Up went past the last 3 entries submitted" );
+        check( shown( KEY_DOWN ) == "three", "Down did not step forward" );
+        check( shown( KEY_DOWN ) == "four", "Down did not step forward" );
+        check( shown( KEY_DOWN ) == "dra",
+                "the draft did not come back past the newest entry" );
+        check( shown( KEY_DOWN ) == "dra", "Down went past the draft" );
+
+        check( shown( KEY_UP ) == "four" && shown( 'x' ) == "fourx",
+                "typing after an entry was recalled" );
+        check( shown( KEY_UP ) == "four" && shown( KEY_DOWN ) == "fourx",
+                "an entry typed over was not kept as the draft" );
+    }
+
+    /*
+     * A worker's redraw() still queued when its widget is destroyed must
+     * not be applied; one posted under the same key afterwards still is.
+     */
+    void destroyed_before_drain() {
+        Channel channel;
+
+        {
+            Table table( { "n" }, Geometry( 4, 10 ), Anchor( 0, 0 ) );
+            table.add( { Text( "2" ) } );
+            table.add( { Text( "1" ) } );
+            table.notify( channel );
+            table.sort( 0 );
+
+            check( posted( channel ), "the worker did not post a redraw" );
+        }
+
+        check( channel.drain() == 0,
+                "a redraw for a destroyed table was applied" );
+
+        {
+            Selector selector( "> ", Geometry( 4, 20 ), Anchor( 0, 0 ) );
+            selector.add( std::vector< std::string >{ "alpha", "beta" } );
+            selector.notify( channel );
+            selector.search( "a" );
+
+            check( posted( channel ), "the search did not post a redraw" );
+        }
+
+        check( channel.drain() == 0,
+                "a redraw for a destroyed selector was applied" );
+
+        int applied = 0;
+        channel.post( &applied, [&applied] { applied += 1; } );
+        channel.forget( &applied );
+        channel.post( &applied, [&applied] { applied += 10; } );
+        channel.drain();
+
+        check( applied == 10, "forget() dropped the wrong updates" );
+    }
+
+#if __cplusplus >= 202002L
+    /*
+     * A coroutine that starts right away and is destroyed by hand, so one
+     * waiting on a button can be destroyed while the button wakes others.
+     */
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() {
+                return { std::coroutine_handle< promise_type >
+                    ::from_promise( *this ) };
+            }
+
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { throw; }
+        };
+
+        std::coroutine_handle< promise_type > handle;
+    };
+
+    Detached wait_then_destroy( Button< int >& button, Detached& other ) {
+        co_await button.pressed();
+        other.handle.destroy();
+    }
+
+    Detached wait( Button< int >& button, int& got ) {
+        got = co_await button.pressed();
+    }
+
+    /* The first task woken destroys the second, before it is woken */
+    void destroyed_while_waking() {
+        Button< int > button( "OK", [] { return 7; } );
+        Detached second;
+
+        int got = 0;
+        Detached first = wait_then_destroy( button, second );
+        second = wait( button, got );
+
+        button.trigger();
+        check( got == 0, "a destroyed task was resumed" );
+
+        /* and the button still works after */
+        Detached third = wait( button, got );
+        button.trigger();
+        check( got == 7, "a task waiting after that was not woken" );
+
+        first.handle.destroy();
+        third.handle.destroy();
+    }
+
+    Task<> throw_when_pressed( Button< int >& button ) {
+        co_await button.pressed();
+        throw std::runtime_error( "task failed" );
+    }
+
+    Task<> add_when_pressed( Button< int >& button, int& got ) {
+        got += co_await button.pressed();
+    }
+
+    /*
+     * A spawned task that throws leaves the others woken with it to run,
+     * and the exception comes out of run().
+     */
+    void spawned_task_throws( Application& app ) {
+        Button< int > button( "OK", [] { return 7; } );
+        int got = 0;
+
+        app.spawn( throw_when_pressed( button ) );
+        app.spawn( add_when_pressed( button, got ) );
+
+        bool thrown = false;
+        try {
+            button.trigger();
+        } catch( ... ) {
+            thrown = true;
+        }
+
+        check( !thrown, "the exception came out of trigger()" );
+        check( got == 7, "a task woken after the failed one did not run" );
+
+        /* in case nothing is thrown, run() still returns */
+        const Application::Wait stop = app.after(
+                std::chrono::milliseconds( 1000 ), [&app] { app.quit(); } );
+
+        std::string what;
+        try {
+            app.run();
+        } catch( const std::runtime_error& e ) {
+            what = e.what();
+        }
+
+        app.cancel( stop );
+        check( what == "task failed", "run() did not throw the exception" );
+    }
+#endif
+
+}
+
+int main() {
+    std::setlocale( LC_CTYPE, "C.UTF-8" );
+    setenv( "LINES", std::to_string( lines ).c_str(), 1 );
+    setenv( "COLUMNS", std::to_string( cols ).c_str(), 1 );
+
+    FILE* sink = std::tmpfile();
+    FILE* input = std::fopen( "/dev/null", "r" );
+    if( !sink || !input ) {
+        std::perror( "tests" );
+        return EXIT_FAILURE;
+    }
+
+    {
+        Application app( sink, input, terminal );
+        Renderer screen( -1 );
+        app.render( &screen );
+
+        run( "frames nest and hold redraws back", [&] {
+            frames( app, screen );
+        } );
+
+        run( "child redrawn, then its parent, in one frame", [&] {
+            child_then_parent( app, screen );
+        } );
+
+        run( "channel collapses keyed posts, keeps unkeyed ones", [&] {
+            channel_updates( app, screen );
+        } );
+
+        run( "channel posts from 4 threads at once", [&] {
+            channel_producers();
+        } );
+
+        run( "432 colour pairs in one frame", [&] {
+            many_pairs( app, screen );
+        } );
+
+        run( "layout sizes by weight, minimum, maximum and padding", [&] {
+            layout_sizes( app, screen );
+        } );
+
+        run( "layout passes on what a capped item leaves", [&] {
+            layout_capped( app, screen );
+        } );
+
+        run( "layout places only what changed", [&] {
+            layout_incremental( app, screen );
+        } );
+
+        run( "table sorts numbers, then text, keeping equal keys", [&] {
+            table_order( app, screen );
+        } );
+
+        run( "table filters, and lists rows added meanwhile last", [&] {
+            table_filter( app, screen );
+        } );
+
+        run( "table column narrows when its widest cell goes", [&] {
+            table_widths( app, screen );
+        } );
+
+        for( unsigned threads : { 2u, 4u } ) {
+            const std::string on = ", " + std::to_string( threads )
+                + " threads";
+
+            run( ( "selector refines as a full search would" + on ).c_str(),
+                    [&] { selector_refine( app, screen, threads ); } );
+
+            run( ( "selector never swaps in a superseded search" + on ).c_str(),
+                    [&] { selector_superseded( app, screen, threads ); } );
+        }
+
+        run( "editor cursor over UTF-8 typed a byte at a time", [&] {
+            editor_cursor( app, screen );
+        } );
+
+        run( "trie completes in order, as far as the words agree", [] {
+            trie_complete();
+        } );
+
+        run( "editor completes with Tab and lists suggestions", [&] {
+            editor_completion( app, screen );
+        } );
+
+        run( "editor steps through its history and back to the draft", [&] {
+            editor_history( app, screen );
+        } );
+
+        run( "widget destroyed with a redraw queued", [&] {
+            destroyed_before_drain();
+        } );
+
+#if __cplusplus >= 202002L
+        run( "task destroyed while a button wakes tasks", [] {
+            destroyed_while_waking();
+        } );
+
+        run( "spawned task throws when woken", [&] {
+            spawned_task_throws( app );
+        } );
+#endif
+
+        app.render( nullptr );
+    }
+
+    std::fclose( input );
+    std::fclose( sink );
+    return failures;
+}